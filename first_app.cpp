@@ -8,6 +8,13 @@
 #include "systems/simple_render_system.hpp"
 #include "systems/point_light_system.hpp"
 #include "lve_buffer.hpp"
+#include "lve_depth_pyramid.hpp"
+#include "lve_frame_allocator.hpp"
+#include "lve_occlusion_rasterizer.hpp"
+#include "lve_pipeline_statistics.hpp"
+#include "lve_render_queue.hpp"
+#include "lve_scene_hierarchy.hpp"
+#include "lve_transform_batch.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -18,6 +25,8 @@
 #include <iostream>
 #include <array>
 #include <chrono>
+#include <cmath>
+#include <random>
 
 namespace lve {
 
@@ -27,44 +36,52 @@ namespace lve {
         // We need to add a pool for the textureImages.
         globalPool = LveDescriptorPool::Builder(lveDevice)
                 .setMaxSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT)
-                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, LveSwapChain::MAX_FRAMES_IN_FLIGHT)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, LveSwapChain::MAX_FRAMES_IN_FLIGHT)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 4 * LveSwapChain::MAX_FRAMES_IN_FLIGHT)
                 .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 * LveSwapChain::MAX_FRAMES_IN_FLIGHT)
                 .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 * LveSwapChain::MAX_FRAMES_IN_FLIGHT) // This is for the texture maps.
                 .build();
 
         loadGameObjects();
+        if (BENCHMARK_OBJECT_COUNT > 0) {
+            loadBenchmarkObjects();
+        }
+        if (BENCHMARK_LIGHT_COUNT > 0) {
+            loadBenchmarkLights();
+        }
         // Texture Image loaded in first_app.hpp file.
     }
 
     FirstApp::~FirstApp() { }
 
     void FirstApp::run() {
-        // The GlobalUbo is a fixed size so we can setup this up here then load in the data later.
-        // So I need to load in the images first.
-        std::vector<std::unique_ptr<LveBuffer>> uboBuffers(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (int i=0;i<uboBuffers.size();i++) {
-            uboBuffers[i] = std::make_unique<LveBuffer>(
-                    lveDevice,
-                    sizeof(GlobalUbo),
-                    1,
-                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-            uboBuffers[i]->map();
-        }
+        // All per-frame uniform and storage data (starting with the GlobalUbo) is bump allocated out
+        // of one persistently mapped buffer and bound with dynamic offsets.
+        LveFrameAllocator frameAllocator{lveDevice, FRAME_ALLOCATOR_BYTES};
 
         auto globalSetLayout = LveDescriptorSetLayout::Builder(lveDevice)
-                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_ALL_GRAPHICS)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,VK_SHADER_STAGE_ALL_GRAPHICS)
                 .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT)
                 .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT)
                 .addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT)
                 .addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT)
                 .addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,VK_SHADER_STAGE_VERTEX_BIT) // per instance data
+                .addBinding(7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,VK_SHADER_STAGE_FRAGMENT_BIT) // point lights
+                .addBinding(8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,VK_SHADER_STAGE_FRAGMENT_BIT) // light clusters
+                .addBinding(9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,VK_SHADER_STAGE_VERTEX_BIT) // light billboards
                 .build();
         // Need to see if anything needs to be done here for the texture maps.
         // Something isn't beting setup right for the Image Info, information is not getting freed correctly.
         std::vector<VkDescriptorSet> globalDescriptorSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
         for (int i=0;i<globalDescriptorSets.size();i++) {
-            auto bufferInfo = uboBuffers[i]->descriptorInfo();
+            auto bufferInfo = frameAllocator.descriptorInfo(sizeof(GlobalUbo));
+            // Dynamic storage bindings need a bounded range; one frame's worth covers any allocation.
+            auto instanceInfo = frameAllocator.descriptorInfo(frameAllocator.getBytesPerFrame());
+            // The light count is unbounded, so the light and cluster tables get the same bound.
+            auto lightInfo = frameAllocator.descriptorInfo(frameAllocator.getBytesPerFrame());
+            auto clusterInfo = frameAllocator.descriptorInfo(frameAllocator.getBytesPerFrame());
+            auto billboardInfo = frameAllocator.descriptorInfo(frameAllocator.getBytesPerFrame());
             auto imageInfo = planetImage->descriptorImageInfo();
             auto imageInfo2 = sharkImage->descriptorImageInfo();
             auto imageInfo3 = shipImage->descriptorImageInfo();
@@ -77,14 +94,31 @@ namespace lve {
                 .writeImage(3, &imageInfo3)
                 .writeImage(4, &imageInfo4)
                 .writeImage(5, &imageInfo5)
+                .writeBuffer(6, &instanceInfo)
+                .writeBuffer(7, &lightInfo)
+                .writeBuffer(8, &clusterInfo)
+                .writeBuffer(9, &billboardInfo)
                 .build(globalDescriptorSets[i]); // Should only build a set once.
         }
 
-        SimpleRenderSystem simpleRenderSystem{lveDevice, lveRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
-        PointLightSystem pointLightSystem{lveDevice, lveRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
+        SimpleRenderSystem simpleRenderSystem{lveDevice, pipelineCompiler, lveRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
+        simpleRenderSystem.setDepthPrepass(DEPTH_PREPASS);
+        simpleRenderSystem.setBvhCulling(BVH_CULLING);
+        // The benchmark cubes share one model; instanced they would be a single packet and leave
+        // the recording threads nothing to split.
+        simpleRenderSystem.setInstancing(BENCHMARK_OBJECT_COUNT == 0);
+        PointLightSystem pointLightSystem{lveDevice, pipelineCompiler, lveRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
+        pointLightSystem.setObjectLightLists(OBJECT_LIGHT_LISTS);
         LveCamera camera{};
         camera.setViewTarget(glm::vec3(-1.f, -2.f, -2.f), glm::vec3(0.f, 0.f, 2.5f));
 
+        if (BVH_BENCHMARK) {
+            LveCamera benchmarkCamera{};
+            benchmarkCamera.setViewYXZ(glm::vec3{0.f}, glm::vec3{0.f});
+            benchmarkCamera.setPerspectiveProjection(glm::radians(50.f), lveRenderer.getAspectRatio(), 0.1f, 100.f);
+            LveBvh::runBenchmark(std::cout, benchmarkCamera.getFrustumPlanes());
+        }
+
         auto viewerObject = LveGameObject::createGameObject();
         viewerObject.transform.translation.z = -2.5f;
         KeyboardMovementController cameraController{};
@@ -99,6 +133,45 @@ namespace lve {
         glm::vec3 monsterOriginalScale;
 
         float frameCount = 0.0f;
+        float memoryReportTimer = 0.0f;
+        lveDevice.printMemoryStats(std::cout);
+
+        // The benchmark steps through 1, 2, 4 ... threads, otherwise every thread records.
+        uint32_t recordingTasks = BENCHMARK_OBJECT_COUNT > 0 ? 1 : threadPool.getThreadCount();
+        float benchmarkTimer = 0.0f;
+        double benchmarkRecordSeconds = 0.0;
+        int benchmarkFrames = 0;
+        LveRenderQueue renderQueue;
+        std::vector<LveGameObject::id_t> changedTransforms;
+        bool transformsDrawn = true;  // false after a skipped frame, whose changes never reached the GPU
+        LveSceneHierarchy sceneHierarchy;
+        LveTransformBatch transformBatch;
+        bool batchTransforms = BATCHED_TRANSFORMS;
+        double benchmarkTransformSeconds = 0.0;
+        // Falls back to CPU instancing when indirect draws cannot use firstInstance. The record
+        // benchmark needs a packet per object, which only the CPU path gives.
+        const bool gpuDriven = GPU_DRIVEN_RENDERING && BENCHMARK_OBJECT_COUNT == 0 &&
+                               lveDevice.supportsDrawIndirectFirstInstance();
+        const bool occlusionCulling = gpuDriven && OCCLUSION_CULLING;
+        std::unique_ptr<LveDepthPyramid> depthPyramid;
+        if (occlusionCulling) {
+            depthPyramid = std::make_unique<LveDepthPyramid>(lveDevice, lveRenderer.getSwapChainExtent());
+        }
+        const bool softwareOcclusion = !gpuDriven && SOFTWARE_OCCLUSION;
+        LveOcclusionRasterizer occlusionRasterizer;
+        std::unique_ptr<LvePipelineStatistics> pipelineStatistics;
+        if (MEASURE_FRAGMENT_SHADING) {
+            if (lveDevice.supportsPipelineStatistics()) {
+                pipelineStatistics = std::make_unique<LvePipelineStatistics>(lveDevice);
+            } else {
+                std::cout << "fragment shading: pipeline statistics queries are not supported" << std::endl;
+            }
+        }
+
+        // The pipelines may still be compiling here; their stats are logged once they are all done.
+        std::cout << "startup: " << std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - startupBegin).count() << " ms" << std::endl;
+        bool pipelineStatsLogged = false;
 
         while (!lveWindow.shouldClose()) {
             glfwPollEvents();
@@ -110,29 +183,190 @@ namespace lve {
             float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
             currentTime = newTime;
 
+            if (!pipelineStatsLogged && pipelineCompiler.getPendingCount() == 0) {
+                // Compare a cold start (delete LveDevice::PIPELINE_CACHE_PATH) with the warm one after it.
+                pipelineStatsLogged = true;
+                lveDevice.pipelineCache().printStats(std::cout);
+                pipelineCompiler.printStats(std::cout);
+                auto shaderStats = lveDevice.shaderModules().getStats();
+                std::cout << "shader modules: " << shaderStats.modulesCreated << " created from "
+                          << shaderStats.filesRead << " files read for " << shaderStats.requests
+                          << " pipeline stages" << std::endl;
+            }
+
+            memoryReportTimer += frameTime;
+            if (memoryReportTimer >= MEMORY_REPORT_INTERVAL) {
+                memoryReportTimer = 0.0f;
+                lveDevice.printMemoryStats(std::cout);
+                if (WRITE_MEMORY_REPORT) {
+                    lveDevice.writeMemoryStatsJson(MEMORY_REPORT_PATH);
+                }
+                if (!gpuDriven) {
+                    const auto &cullStats = simpleRenderSystem.getCullStats();
+                    std::cout << "culling: " << cullStats.visible << " of " << cullStats.tested
+                              << " objects visible, " << cullStats.occluded << " occluded" << std::endl;
+                }
+                if (softwareOcclusion) {
+                    const auto &occlusionStats = occlusionRasterizer.getStats();
+                    std::cout << "software occlusion: " << occlusionStats.occluderTriangles << " occluder triangles, "
+                              << occlusionStats.occluded << " of " << occlusionStats.tested << " boxes hidden, setup "
+                              << occlusionStats.setupMilliseconds << " ms, rasterize "
+                              << occlusionStats.rasterizeMilliseconds << " ms, test "
+                              << occlusionStats.testMilliseconds << " ms" << std::endl;
+                }
+                const auto &queueStats = renderQueue.getStats();
+                std::cout << "render queue: " << queueStats.draws << " draws, "
+                          << queueStats.pipelineBinds << " pipeline binds (" << queueStats.pipelineBindsSkipped
+                          << " skipped), " << queueStats.descriptorBinds << " descriptor binds ("
+                          << queueStats.descriptorBindsSkipped << " skipped), " << queueStats.modelBinds
+                          << " model binds (" << queueStats.modelBindsSkipped << " skipped)" << std::endl;
+                const auto &lightStats = pointLightSystem.getLightStats();
+                std::cout << "lights: " << lightStats.visible << " of " << lightStats.lights
+                          << " reach the view";
+                if (OBJECT_LIGHT_LISTS) {
+                    std::cout << ", " << lightStats.objectLightReferences << " light list entries over "
+                              << lightStats.litObjects << " objects";
+                }
+                std::cout << std::endl;
+                const auto &clusterStats = pointLightSystem.getClusterStats();
+                std::cout << "light clusters: " << clusterStats.lights << " lights in view, "
+                          << clusterStats.lightReferences << " cluster references, at most "
+                          << clusterStats.maxClusterLights << " per cluster, built in "
+                          << clusterStats.buildMilliseconds << " ms" << std::endl;
+                std::cout << "transforms: " << changedTransforms.size() << " of " << gameObjects.size()
+                          << " changed last frame" << std::endl;
+                if (pipelineStatistics) {
+                    std::cout << "fragment shading: " << pipelineStatistics->getFragmentShaderInvocations()
+                              << " invocations per frame " << (simpleRenderSystem.hasDepthPrepass() ? "with" : "without")
+                              << " depth prepass" << std::endl;
+                    simpleRenderSystem.setDepthPrepass(!simpleRenderSystem.hasDepthPrepass());
+                }
+            }
+
             cameraController.moveInPlaneXZ(lveWindow.getGLFWwindow(), frameTime, viewerObject);
             camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
 
+            for (auto id : benchmarkObjectIds) {
+                gameObjects.at(id).transform.rotation.y += frameTime;
+            }
+            // Rebuilds only the matrices that changed; the render threads then just read the caches.
+            auto transformStart = std::chrono::high_resolution_clock::now();
+            sceneHierarchy.update(gameObjects, changedTransforms, batchTransforms ? &transformBatch : nullptr);
+            updateSceneBvh(changedTransforms);
+            if (BENCHMARK_OBJECT_COUNT > 0) {
+                benchmarkTransformSeconds += std::chrono::duration<double>(
+                        std::chrono::high_resolution_clock::now() - transformStart).count();
+            }
+
             float aspect = lveRenderer.getAspectRatio();
             camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
             if (auto commandBuffer = lveRenderer.beginFrame()) {
                 int frameIndex = lveRenderer.getFrameIndex();
-                FrameInfo frameInfo{frameIndex, frameTime, commandBuffer,camera, globalDescriptorSets[frameIndex], gameObjects};
+                if (occlusionCulling) {
+                    depthPyramid->resize(lveRenderer.getSwapChainExtent());
+                }
+                if (pipelineStatistics) {
+                    pipelineStatistics->begin(commandBuffer, frameIndex);
+                }
+                frameAllocator.beginFrame(frameIndex);
+                FrameInfo frameInfo{frameIndex, frameTime, commandBuffer,camera, globalDescriptorSets[frameIndex], gameObjects, frameAllocator};
+                frameInfo.sceneBvh = &sceneBvh;
+                frameInfo.changedTransforms = transformsDrawn ? &changedTransforms : nullptr;
+                transformsDrawn = true;
+                frameInfo.extent = lveRenderer.getSwapChainExtent();
+                if (softwareOcclusion) {
+                    occlusionRasterizer.begin(camera.getProjection() * camera.getView());
+                    for (auto id : gameObjects.withOccluder()) {
+                        const LveGameObject &gameObject = gameObjects.at(id);
+                        occlusionRasterizer.addOccluder(*gameObject.occluder, gameObject.getWorldTransform());
+                    }
+                    occlusionRasterizer.rasterize(&threadPool);
+                    frameInfo.occlusionRasterizer = &occlusionRasterizer;
+                }
                 //update
                 GlobalUbo ubo{};
                 ubo.projection = camera.getProjection();
                 ubo.view = camera.getView();
                 ubo.inverseView = camera.getInverseView();
                 pointLightSystem.update(frameInfo, ubo);
-                uboBuffers[frameIndex]->writeToBuffer(&ubo);
-                uboBuffers[frameIndex]->flush();
+                frameInfo.globalUboOffset = frameAllocator.push(ubo).offset;
 
                 //render
-                lveRenderer.beginSwapChainRenderPass(commandBuffer);
-                simpleRenderSystem.render(frameInfo); // Solid Objects
-                pointLightSystem.render(frameInfo);  // Transparent Objects
-                lveRenderer.endSwapChainRenderPass(commandBuffer);
+                auto recordStart = std::chrono::high_resolution_clock::now();
+                // Sorts and records the queued packets in the swap chain render pass, or with resume
+                // in its continuation that keeps what was drawn before.
+                auto recordRenderQueue = [&](bool resume) {
+                    renderQueue.sort();
+                    VkSubpassContents contents = PARALLEL_RECORDING
+                            ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+                    if (resume) {
+                        lveRenderer.resumeSwapChainRenderPass(commandBuffer, contents);
+                    } else {
+                        // With occlusion culling the depth pyramid is built from this pass's depth.
+                        lveRenderer.beginSwapChainRenderPass(commandBuffer, contents, occlusionCulling);
+                    }
+                    if (PARALLEL_RECORDING) {
+                        lveRenderer.executeSecondaryCommandBuffers(
+                                commandBuffer,
+                                renderQueue.executeParallel(frameInfo, lveRenderer, threadPool, recordingTasks));
+                    } else {
+                        renderQueue.execute(commandBuffer, frameInfo);
+                    }
+                    lveRenderer.endSwapChainRenderPass(commandBuffer);
+                };
+
+                renderQueue.clear();
+                if (gpuDriven) {
+                    // The compute pass has to be recorded before the render pass begins.
+                    simpleRenderSystem.cull(frameInfo, occlusionCulling);
+                    simpleRenderSystem.submitIndirect(frameInfo, renderQueue); // Solid Objects
+                } else {
+                    simpleRenderSystem.submit(frameInfo, renderQueue, &threadPool); // Solid Objects
+                }
+                if (occlusionCulling) {
+                    // Draw what was visible last frame, build the depth pyramid from it, then draw
+                    // whatever it does not hide that is not drawn yet.
+                    recordRenderQueue(false);
+                    depthPyramid->build(
+                            commandBuffer, frameIndex, lveRenderer.getDepthImage(), lveRenderer.getDepthImageView(),
+                            lveRenderer.getDepthFormat());
+                    simpleRenderSystem.cullOccluded(frameInfo, *depthPyramid);
+                    renderQueue.clear();
+                    simpleRenderSystem.submitIndirect(frameInfo, renderQueue);
+                }
+                pointLightSystem.submit(frameInfo, renderQueue);  // Transparent Objects
+                recordRenderQueue(occlusionCulling);
+
+                if (BENCHMARK_OBJECT_COUNT > 0) {
+                    benchmarkRecordSeconds += std::chrono::duration<double>(
+                            std::chrono::high_resolution_clock::now() - recordStart).count();
+                    benchmarkFrames++;
+                    benchmarkTimer += frameTime;
+                    if (benchmarkTimer >= BENCHMARK_INTERVAL) {
+                        std::cout << "record " << gameObjects.size() << " objects on " << recordingTasks
+                                  << " thread(s): " << benchmarkRecordSeconds * 1000.0 / benchmarkFrames
+                                  << " ms/frame, " << (batchTransforms ? "SIMD" : "scalar") << " transforms: "
+                                  << benchmarkTransformSeconds * 1000.0 / benchmarkFrames << " ms/frame" << std::endl;
+                        if (recordingTasks >= threadPool.getThreadCount()) {
+                            // Each full sweep of thread counts alternates the transform path.
+                            recordingTasks = 1;
+                            batchTransforms = !batchTransforms;
+                        } else {
+                            recordingTasks = std::min(recordingTasks * 2, threadPool.getThreadCount());
+                        }
+                        benchmarkTimer = 0.0f;
+                        benchmarkRecordSeconds = 0.0;
+                        benchmarkTransformSeconds = 0.0;
+                        benchmarkFrames = 0;
+                    }
+                }
+                if (pipelineStatistics) {
+                    pipelineStatistics->end(commandBuffer, frameIndex);
+                }
+                frameAllocator.flush();
                 lveRenderer.endFrame();
+            } else {
+                transformsDrawn = false;
             }
 
             //Monster Animation Process
@@ -170,6 +404,54 @@ namespace lve {
         vkDeviceWaitIdle(lveDevice.device());
     }
 
+    void FirstApp::updateSceneBvh(const std::vector<LveGameObject::id_t> &changedTransforms) {
+        const auto &modelIds = gameObjects.withModel();
+        if (sceneBvh.size() != modelIds.size() || sceneBvhStructureVersion != gameObjects.getStructureVersion()) {
+            // Objects were added or removed; the tree is rebuilt anyway, so just start over.
+            sceneBvhStructureVersion = gameObjects.getStructureVersion();
+            sceneBvh.clear();
+            for (auto id : modelIds) {
+                sceneBvh.set(id, gameObjects.at(id).getWorldBoundingSphere());
+            }
+        } else {
+            for (auto id : changedTransforms) {
+                const LveGameObject &gameObject = gameObjects.at(id);
+                if (gameObject.model != nullptr) {
+                    sceneBvh.set(id, gameObject.getWorldBoundingSphere());
+                }
+            }
+        }
+        sceneBvh.update();
+    }
+
+    void FirstApp::loadBenchmarkObjects() {
+        std::shared_ptr<LveModel> cubeModel = LveModel::createModelFromFile(lveDevice, "../models/colored_cube.obj");
+
+        // A square grid of small cubes on a plane below the scene.
+        int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(BENCHMARK_OBJECT_COUNT))));
+        for (int i = 0; i < BENCHMARK_OBJECT_COUNT; i++) {
+            auto cube = LveGameObject::createGameObject();
+            cube.model = cubeModel;
+            cube.transform.translation = {(i % side - side / 2) * 0.3f, 3.f, (i / side) * 0.3f};
+            cube.transform.scale = {0.1f, 0.1f, 0.1f};
+            cube.textureBinding = 0;
+            benchmarkObjectIds.push_back(cube.getId());
+            gameObjects.emplace(cube.getId(), std::move(cube));
+        }
+    }
+
+    void FirstApp::loadBenchmarkLights() {
+        // Small colored lights scattered through the scene, each reaching only a few clusters.
+        std::mt19937 generator{1};
+        std::uniform_real_distribution<float> unit{0.f, 1.f};
+        for (int i = 0; i < BENCHMARK_LIGHT_COUNT; i++) {
+            auto light = LveGameObject::makePointLight(0.01f, 0.02f, {unit(generator), unit(generator), unit(generator)});
+            light.transform.translation = {(unit(generator) - 0.5f) * 20.f, (unit(generator) - 0.5f) * 6.f,
+                                           unit(generator) * 20.f};
+            gameObjects.emplace(light.getId(), std::move(light));
+        }
+    }
+
     void FirstApp::loadGameObjects() {
 
         float animationDuration = 4.0f;
@@ -182,6 +464,8 @@ namespace lve {
         planet.transform.translation = {-0.0f, 1.5f, 10.f};
         planet.transform.scale = {-2.f, -2.f, -2.f};
         planet.textureBinding = 1;
+        // A box inside the unit sphere of the planet's body; the rings and moon are too thin to hide much.
+        planet.occluder = LveOccluder::createBox(glm::vec3{-0.57f}, glm::vec3{0.57f});
         PLANET_ID = planet.getId();
         AnimationSequence planetAnimation;
 
@@ -214,7 +498,7 @@ namespace lve {
 
         //CHILD OBJECT TO PLANET
         auto childPlanet = LveGameObject::createGameObject();
-        //childPlanet.setParent(planet); // Set the larger planet as the parent of the smaller planet
+        //childPlanet.setParent(PLANET_ID); // Set the larger planet as the parent of the smaller planet
 
         // Set the child planet's local transformation relative to the parent
         childPlanet.transform.translation = {1.0f, 0.0f, 0.0f}; // Position relative to the parent planet
@@ -305,6 +589,7 @@ namespace lve {
         background.transform.translation = {30.f, 30.f, 15.f};
         background.transform.scale = {-30.f, -20.f, 0.0f};
         background.textureBinding = 4;
+        background.occluder = LveOccluder::createFromFile("../models/Background.obj");
         gameObjects.emplace(background.getId(),std::move(background));
 
         std::vector<glm::vec3> lightColors{
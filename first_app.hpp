@@ -6,13 +6,17 @@
 #define VULKANTEST_FIRST_APP_HPP
 
 #include "lve_window.hpp"
+#include "lve_bvh.hpp"
 #include "lve_game_object.hpp"
 #include "lve_device.hpp"
 #include "lve_renderer.hpp"
 #include "lve_descriptors.hpp"
 #include "lve_image.hpp"
+#include "lve_pipeline_compiler.hpp"
+#include "lve_thread_pool.hpp"
 
 
+#include <chrono>
 #include <memory>
 #include <vector>
 
@@ -22,6 +26,35 @@ namespace lve {
     public:
         static constexpr int WIDTH = 800;
         static constexpr int HEIGHT = 600;
+        static constexpr VkDeviceSize FRAME_ALLOCATOR_BYTES = 4 * 1024 * 1024;
+        static constexpr float MEMORY_REPORT_INTERVAL = 30.f; // seconds between GPU memory reports
+        // Also writes each GPU memory report to MEMORY_REPORT_PATH in the working directory.
+        static constexpr bool WRITE_MEMORY_REPORT = false;
+        static constexpr const char *MEMORY_REPORT_PATH = "memory_report.json";
+        static constexpr bool PARALLEL_RECORDING = true;      // record the scene on all cores via secondaries
+        static constexpr bool GPU_DRIVEN_RENDERING = true;    // cull and build draws in a compute pass
+        static constexpr bool OCCLUSION_CULLING = true;       // two-phase Hi-Z occlusion culling on the GPU driven path
+        static constexpr bool SOFTWARE_OCCLUSION = true;      // CPU rasterized occluders hide objects on the CPU path
+        // Opaque draws are already sorted front to back, so early depth tests reject much of the
+        // overdraw; measure with MEASURE_FRAGMENT_SHADING before turning this on for a scene.
+        static constexpr bool DEPTH_PREPASS = false;          // depth only pass first, so each pixel is shaded once
+        // Logs fragment shader invocations per frame with each report, switching the depth
+        // prepass on or off after every one so both can be compared.
+        static constexpr bool MEASURE_FRAGMENT_SHADING = false;
+        static constexpr bool BATCHED_TRANSFORMS = true;      // rebuild changed transforms with SIMD
+        // Shade each object with its few brightest lights instead of its fragments' light clusters.
+        static constexpr bool OBJECT_LIGHT_LISTS = false;
+        // Set to e.g. 20000 to add a grid of spinning cubes and log CPU record time for 1..N recording
+        // threads, and transform rebuild time with and without SIMD. The run draws on the CPU path
+        // without instancing, so every cube is a draw packet of its own.
+        static constexpr int BENCHMARK_OBJECT_COUNT = 0;
+        static constexpr float BENCHMARK_INTERVAL = 5.f;      // seconds measured per thread count
+        // Frustum cull the CPU path through the scene BVH; off tests every object with the SIMD culler.
+        static constexpr bool BVH_CULLING = true;
+        static constexpr bool BVH_BENCHMARK = false;          // time BVH queries against brute force at startup
+        // Set to e.g. 4000 to scatter small point lights through the scene; the light cluster
+        // build time is logged with each report.
+        static constexpr int BENCHMARK_LIGHT_COUNT = 0;
 
         FirstApp();
         ~FirstApp();
@@ -37,9 +70,17 @@ namespace lve {
         bool isAnimatingShip = false;
         int MONSTER_ID, PLANET_ID, SHIP_ID;
         void loadGameObjects();
+        void loadBenchmarkObjects();
+        void loadBenchmarkLights();
+        void updateSceneBvh(const std::vector<LveGameObject::id_t> &changedTransforms);
+        std::vector<LveGameObject::id_t> benchmarkObjectIds;
 
+        // Initialized before lveWindow and lveDevice, so the startup time logged by run() includes
+        // creating them.
+        std::chrono::high_resolution_clock::time_point startupBegin = std::chrono::high_resolution_clock::now();
         LveWindow lveWindow{WIDTH, HEIGHT, "Hello Vulkan!"};
         LveDevice lveDevice{lveWindow};
+        LvePipelineCompiler pipelineCompiler{lveDevice};
         std::shared_ptr<LveImage> planetImage = LveImage::createImageFromFile(lveDevice, "../textures/Saturn2.png");
         std::shared_ptr<LveImage> sharkImage = LveImage::createImageFromFile(lveDevice, "../textures/Monster_Color.jpg");
         std::shared_ptr<LveImage> shipImage = LveImage::createImageFromFile(lveDevice, "../textures/Metal.png");
@@ -49,11 +90,14 @@ namespace lve {
         //createTextureImage();
         //createTextureImageView();
         // Here is where they create the VertexBuffer, IndexBuffer, and UniformBuffer.
-        LveRenderer lveRenderer{lveWindow, lveDevice};
+        LveThreadPool threadPool{};
+        LveRenderer lveRenderer{lveWindow, lveDevice, threadPool.getThreadCount()};
 
         //note: Order of declaration is important.
         std::unique_ptr<LveDescriptorPool> globalPool{};
         LveGameObject::Map gameObjects;
+        LveBvh sceneBvh;
+        uint32_t sceneBvhStructureVersion = 0;
     };
 }
 
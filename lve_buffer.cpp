@@ -8,6 +8,7 @@
 #include "lve_buffer.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -35,7 +36,8 @@ namespace lve {
             uint32_t instanceCount,
             VkBufferUsageFlags usageFlags,
             VkMemoryPropertyFlags memoryPropertyFlags,
-            VkDeviceSize minOffsetAlignment)
+            VkDeviceSize minOffsetAlignment,
+            VkMemoryPropertyFlags preferredMemoryPropertyFlags)
             : lveDevice{device},
               instanceSize{instanceSize},
               instanceCount{instanceCount},
@@ -43,18 +45,41 @@ namespace lve {
               memoryPropertyFlags{memoryPropertyFlags} {
         alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
         bufferSize = alignmentSize * instanceCount;
-        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+
+        // Host visible buffers prefer coherent memory so writes never need an explicit flush.
+        if (memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            preferredMemoryPropertyFlags |= VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        }
+        this->memoryPropertyFlags = device.createBuffer(
+                bufferSize,
+                usageFlags,
+                memoryPropertyFlags,
+                buffer,
+                memory,
+                LveDevice::memoryCategoryForUsage(usageFlags),
+                preferredMemoryPropertyFlags);
+
+        if (usageFlags & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR) {
+            deviceAddress = device.getBufferDeviceAddress(buffer);
+        }
+
+        // Host visible buffers stay mapped for their whole lifetime.
+        if (this->memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            map();
+        }
     }
 
     LveBuffer::~LveBuffer() {
         unmap();
         vkDestroyBuffer(lveDevice.device(), buffer, nullptr);
-        vkFreeMemory(lveDevice.device(), memory, nullptr);
+        lveDevice.freeMemory(memory);
     }
 
 /**
  * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
  *
+ * @note Host visible buffers are persistently mapped on creation, in which case this is a no-op
+ *
  * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
  * buffer range.
  * @param offset (Optional) Byte offset from beginning
@@ -63,6 +88,9 @@ namespace lve {
  */
     VkResult LveBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
         assert(buffer && memory && "Called map on buffer before create");
+        if (mapped) {
+            return VK_SUCCESS;
+        }
         return vkMapMemory(lveDevice.device(), memory, offset, size, 0, &mapped);
     }
 
@@ -111,11 +139,10 @@ namespace lve {
  * @return VkResult of the flush call
  */
     VkResult LveBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        if (isCoherent()) {
+            return VK_SUCCESS;
+        }
+        VkMappedMemoryRange mappedRange = alignedRange(size, offset);
         return vkFlushMappedMemoryRanges(lveDevice.device(), 1, &mappedRange);
     }
 
@@ -131,12 +158,90 @@ namespace lve {
  * @return VkResult of the invalidate call
  */
     VkResult LveBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
+        if (isCoherent()) {
+            return VK_SUCCESS;
+        }
+        VkMappedMemoryRange mappedRange = alignedRange(size, offset);
+        return vkInvalidateMappedMemoryRanges(lveDevice.device(), 1, &mappedRange);
+    }
+
+/**
+ * Expands a range to the device's nonCoherentAtomSize, as required for flush and invalidate
+ *
+ * @param size Size of the memory range. VK_WHOLE_SIZE, or a range reaching the end of the buffer,
+ * covers the rest of the allocation.
+ * @param offset Byte offset from beginning
+ *
+ * @return VkMappedMemoryRange that is valid to pass to vkFlushMappedMemoryRanges
+ */
+    VkMappedMemoryRange LveBuffer::alignedRange(VkDeviceSize size, VkDeviceSize offset) const {
+        VkDeviceSize atomSize = lveDevice.properties.limits.nonCoherentAtomSize;
+
         VkMappedMemoryRange mappedRange = {};
         mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
         mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(lveDevice.device(), 1, &mappedRange);
+        mappedRange.offset = offset / atomSize * atomSize;
+        mappedRange.size = VK_WHOLE_SIZE;
+        if (size != VK_WHOLE_SIZE) {
+            VkDeviceSize end = (offset + size + atomSize - 1) / atomSize * atomSize;
+            if (end < bufferSize) {
+                mappedRange.size = end - mappedRange.offset;
+            }
+        }
+        return mappedRange;
+    }
+
+/**
+ * Queue a memory range to be flushed by the next flushPending call
+ *
+ * @note Ignored for coherent memory
+ *
+ * @param size (Optional) Size of the memory range to flush. Pass VK_WHOLE_SIZE to flush the
+ * complete buffer range.
+ * @param offset (Optional) Byte offset from beginning
+ */
+    void LveBuffer::addFlushRange(VkDeviceSize size, VkDeviceSize offset) {
+        if (isCoherent()) {
+            return;
+        }
+        pendingFlushRanges.push_back(alignedRange(size, offset));
+    }
+
+/**
+ * Flush all queued ranges, merged where they touch, with a single vkFlushMappedMemoryRanges call
+ *
+ * @return VkResult of the flush call
+ */
+    VkResult LveBuffer::flushPending() {
+        if (pendingFlushRanges.empty()) {
+            return VK_SUCCESS;
+        }
+
+        std::sort(
+                pendingFlushRanges.begin(),
+                pendingFlushRanges.end(),
+                [](const VkMappedMemoryRange &a, const VkMappedMemoryRange &b) { return a.offset < b.offset; });
+
+        size_t count = 1;
+        for (size_t i = 1; i < pendingFlushRanges.size(); i++) {
+            auto &last = pendingFlushRanges[count - 1];
+            const auto &range = pendingFlushRanges[i];
+            if (last.size == VK_WHOLE_SIZE) {
+                break;
+            }
+            if (range.offset <= last.offset + last.size) {
+                last.size = range.size == VK_WHOLE_SIZE
+                        ? VK_WHOLE_SIZE
+                        : std::max(last.offset + last.size, range.offset + range.size) - last.offset;
+            } else {
+                pendingFlushRanges[count++] = range;
+            }
+        }
+
+        VkResult result = vkFlushMappedMemoryRanges(
+                lveDevice.device(), static_cast<uint32_t>(count), pendingFlushRanges.data());
+        pendingFlushRanges.clear();
+        return result;
     }
 
 /**
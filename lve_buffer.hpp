@@ -7,6 +7,9 @@
 
 #include "lve_device.hpp"
 
+// std
+#include <vector>
+
 namespace lve {
 
     class LveBuffer {
@@ -17,7 +20,8 @@ namespace lve {
                 uint32_t instanceCount,
                 VkBufferUsageFlags usageFlags,
                 VkMemoryPropertyFlags memoryPropertyFlags,
-                VkDeviceSize minOffsetAlignment = 1);
+                VkDeviceSize minOffsetAlignment = 1,
+                VkMemoryPropertyFlags preferredMemoryPropertyFlags = 0);
         ~LveBuffer();
 
         LveBuffer(const LveBuffer&) = delete;
@@ -36,6 +40,12 @@ namespace lve {
         VkDescriptorBufferInfo descriptorInfoForIndex(int index);
         VkResult invalidateIndex(int index);
 
+        // Queue ranges and flush them all with a single vkFlushMappedMemoryRanges call.
+        void addFlushRange(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+        VkResult flushPending();
+
+        bool isCoherent() const { return memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT; }
+
         VkBuffer getBuffer() const { return buffer; }
         void* getMappedMemory() const { return mapped; }
         uint32_t getInstanceCount() const { return instanceCount; }
@@ -45,20 +55,27 @@ namespace lve {
         VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
         VkDeviceSize getBufferSize() const { return bufferSize; }
 
+        // Only valid for buffers created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR.
+        VkDeviceAddress getDeviceAddress() const { return deviceAddress; }
+        VkDeviceAddress getDeviceAddressForIndex(int index) const { return deviceAddress + index * alignmentSize; }
+
     private:
         static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
+        VkMappedMemoryRange alignedRange(VkDeviceSize size, VkDeviceSize offset) const;
 
         LveDevice& lveDevice;
         void* mapped = nullptr;
         VkBuffer buffer = VK_NULL_HANDLE;
         VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceAddress deviceAddress = 0;
 
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
         VkDeviceSize instanceSize;
         VkDeviceSize alignmentSize;
         VkBufferUsageFlags usageFlags;
-        VkMemoryPropertyFlags memoryPropertyFlags;
+        VkMemoryPropertyFlags memoryPropertyFlags;  // of the memory type actually used
+        std::vector<VkMappedMemoryRange> pendingFlushRanges;
     };
 
 }  // namespace lve
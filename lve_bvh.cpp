@@ -0,0 +1,511 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+#include "lve_bvh.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace lve {
+
+    void LveBvh::Bounds::grow(const Bounds &other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    void LveBvh::Bounds::grow(const glm::vec3 &point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    float LveBvh::Bounds::area() const {
+        glm::vec3 extent = max - min;
+        if (extent.x < 0.f) return 0.f;
+        return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+
+    LveBvh::Bounds LveBvh::sphereBounds(const glm::vec4 &sphere) {
+        Bounds bounds;
+        bounds.min = glm::vec3{sphere} - glm::vec3{sphere.w};
+        bounds.max = glm::vec3{sphere} + glm::vec3{sphere.w};
+        return bounds;
+    }
+
+    void LveBvh::clear() {
+        spheres.clear();
+        nodes.clear();
+        primitives.clear();
+        primitiveLeaf.clear();
+        movedPrimitives.clear();
+        needsRebuild = false;
+        costSum = 0.0;
+        builtCost = 0.f;
+        cost = 0.f;
+    }
+
+    void LveBvh::set(uint32_t id, const glm::vec3 &center, float radius) {
+        if (spheres.contains(id)) {
+            spheres.at(id) = glm::vec4{center, radius};
+            if (!needsRebuild) {
+                movedPrimitives.push_back(spheres.indexOf(id));
+            }
+        } else {
+            spheres.emplace(id, glm::vec4{center, radius});
+            needsRebuild = true;
+        }
+    }
+
+    void LveBvh::remove(uint32_t id) {
+        spheres.erase(id);
+        needsRebuild = true;
+    }
+
+    void LveBvh::update() {
+        if (needsRebuild) {
+            build();
+            return;
+        }
+        if (movedPrimitives.empty()) {
+            return;
+        }
+        refit();
+        if (cost > builtCost * REBUILD_COST_RATIO) {
+            build();
+        }
+    }
+
+    void LveBvh::build() {
+        uint32_t count = static_cast<uint32_t>(spheres.size());
+        nodes.clear();
+        primitives.resize(count);
+        primitiveLeaf.resize(count);
+        centroids.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            primitives[i] = i;
+            centroids[i] = glm::vec3{spheres.valueAt(i)};
+        }
+        movedPrimitives.clear();
+        needsRebuild = false;
+        rebuildCount++;
+
+        if (count == 0) {
+            costSum = 0.0;
+            builtCost = cost = 0.f;
+            return;
+        }
+
+        nodes.reserve(2 * static_cast<size_t>(count));
+        Node root{};
+        root.count = count;
+        nodes.push_back(root);
+
+        // Explicit stack of (node, depth), so degenerate scenes cannot overflow the call stack.
+        std::vector<std::pair<uint32_t, uint32_t>> stack{{0, 0}};
+        while (!stack.empty()) {
+            auto [nodeIndex, depth] = stack.back();
+            stack.pop_back();
+            if (subdivide(nodeIndex, depth)) {
+                stack.push_back({nodes[nodeIndex].first, depth + 1});
+                stack.push_back({nodes[nodeIndex].first + 1, depth + 1});
+            }
+        }
+
+        costSum = computeCostSum();
+        builtCost = cost = static_cast<float>(costSum / std::max(nodes[0].bounds.area(), FLT_MIN));
+    }
+
+    bool LveBvh::subdivide(uint32_t nodeIndex, uint32_t depth) {
+        const uint32_t first = nodes[nodeIndex].first;
+        const uint32_t count = nodes[nodeIndex].count;
+
+        Bounds bounds;
+        Bounds centroidBounds;
+        for (uint32_t i = first; i < first + count; i++) {
+            bounds.grow(sphereBounds(spheres.valueAt(primitives[i])));
+            centroidBounds.grow(centroids[primitives[i]]);
+        }
+        nodes[nodeIndex].bounds = bounds;
+
+        auto makeLeaf = [&]() {
+            for (uint32_t i = first; i < first + count; i++) {
+                primitiveLeaf[primitives[i]] = nodeIndex;
+            }
+            return false;
+        };
+        // Queries keep a fixed size stack, so the depth is capped by making a bigger leaf.
+        if (count <= MAX_LEAF_SIZE || depth + 1 >= MAX_DEPTH) {
+            return makeLeaf();
+        }
+
+        // Binned SAH: sort the centroids into bins along each axis and try a split between every
+        // pair of neighbouring bins.
+        int bestAxis = -1;
+        uint32_t bestSplit = 0;
+        float bestCost = FLT_MAX;
+        for (int axis = 0; axis < 3; axis++) {
+            float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+            if (extent <= 0.f) continue;
+
+            std::array<Bounds, SAH_BINS> binBounds{};
+            std::array<uint32_t, SAH_BINS> binCounts{};
+            float scale = SAH_BINS / extent;
+            for (uint32_t i = first; i < first + count; i++) {
+                uint32_t primitive = primitives[i];
+                auto bin = std::min(SAH_BINS - 1, static_cast<uint32_t>(
+                        (centroids[primitive][axis] - centroidBounds.min[axis]) * scale));
+                binBounds[bin].grow(sphereBounds(spheres.valueAt(primitive)));
+                binCounts[bin]++;
+            }
+
+            std::array<float, SAH_BINS - 1> leftCosts{};
+            Bounds left;
+            uint32_t leftCount = 0;
+            for (uint32_t split = 0; split < SAH_BINS - 1; split++) {
+                left.grow(binBounds[split]);
+                leftCount += binCounts[split];
+                leftCosts[split] = leftCount * left.area();
+            }
+            Bounds right;
+            uint32_t rightCount = 0;
+            for (uint32_t split = SAH_BINS - 1; split > 0; split--) {
+                right.grow(binBounds[split]);
+                rightCount += binCounts[split];
+                float splitCost = leftCosts[split - 1] + rightCount * right.area();
+                if (splitCost < bestCost) {
+                    bestCost = splitCost;
+                    bestAxis = axis;
+                    bestSplit = split - 1;
+                }
+            }
+        }
+
+        // With coincident centroids the split is just by position in the list.
+        uint32_t leftCount = count / 2;
+        if (bestAxis >= 0) {
+            // Cost in units of one node traversal, against testing every primitive here.
+            if (bestCost / bounds.area() + 1.f >= static_cast<float>(count) && count <= MAX_LEAF_SIZE * 4) {
+                return makeLeaf();
+            }
+            float scale = SAH_BINS / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+            float minimum = centroidBounds.min[bestAxis];
+            auto middle = std::partition(
+                    primitives.begin() + first, primitives.begin() + first + count, [&](uint32_t primitive) {
+                        auto bin = std::min(SAH_BINS - 1, static_cast<uint32_t>(
+                                (centroids[primitive][bestAxis] - minimum) * scale));
+                        return bin <= bestSplit;
+                    });
+            leftCount = static_cast<uint32_t>(middle - (primitives.begin() + first));
+            if (leftCount == 0 || leftCount == count) {
+                leftCount = count / 2;
+            }
+        }
+
+        uint32_t leftIndex = static_cast<uint32_t>(nodes.size());
+        Node leftChild{};
+        leftChild.first = first;
+        leftChild.count = leftCount;
+        leftChild.parent = nodeIndex;
+        Node rightChild{};
+        rightChild.first = first + leftCount;
+        rightChild.count = count - leftCount;
+        rightChild.parent = nodeIndex;
+        nodes.push_back(leftChild);
+        nodes.push_back(rightChild);
+        nodes[nodeIndex].first = leftIndex;
+        nodes[nodeIndex].count = 0;
+        return true;
+    }
+
+    double LveBvh::nodeCost(const Node &node) const {
+        return static_cast<double>(node.bounds.area()) * (node.count == 0 ? 1.0 : node.count);
+    }
+
+    double LveBvh::computeCostSum() const {
+        double sum = 0.0;
+        for (const auto &node : nodes) {
+            sum += nodeCost(node);
+        }
+        return sum;
+    }
+
+    void LveBvh::refit() {
+        for (uint32_t primitive : movedPrimitives) {
+            uint32_t nodeIndex = primitiveLeaf[primitive];
+            while (nodeIndex != INVALID_NODE) {
+                Node &node = nodes[nodeIndex];
+                Bounds bounds;
+                if (node.count > 0) {
+                    for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                        bounds.grow(sphereBounds(spheres.valueAt(primitives[i])));
+                    }
+                } else {
+                    bounds = nodes[node.first].bounds;
+                    bounds.grow(nodes[node.first + 1].bounds);
+                }
+                if (bounds.min == node.bounds.min && bounds.max == node.bounds.max) {
+                    break;  // the ancestors already enclose it
+                }
+                costSum -= nodeCost(node);
+                node.bounds = bounds;
+                costSum += nodeCost(node);
+                nodeIndex = node.parent;
+            }
+        }
+        movedPrimitives.clear();
+        cost = static_cast<float>(costSum / std::max(nodes[0].bounds.area(), FLT_MIN));
+    }
+
+    void LveBvh::collectSubtree(uint32_t nodeIndex, std::vector<uint32_t> &ids) const {
+        uint32_t stack[MAX_DEPTH + 1];
+        uint32_t top = 0;
+        stack[top++] = nodeIndex;
+        while (top > 0) {
+            const Node &node = nodes[stack[--top]];
+            if (node.count > 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                    ids.push_back(spheres.ids()[primitives[i]]);
+                }
+            } else {
+                stack[top++] = node.first;
+                stack[top++] = node.first + 1;
+            }
+        }
+    }
+
+    void LveBvh::queryFrustum(const std::array<glm::vec4, 6> &planes, std::vector<uint32_t> &ids) const {
+        if (nodes.empty()) return;
+        assert(!needsRebuild && movedPrimitives.empty() && "Call update before querying");
+
+        uint32_t stack[MAX_DEPTH + 1];
+        uint32_t top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            uint32_t nodeIndex = stack[--top];
+            const Node &node = nodes[nodeIndex];
+
+            // Per plane, the box corner furthest along the normal decides outside, and the
+            // nearest corner decides whether the box is entirely inside.
+            bool outside = false;
+            bool inside = true;
+            for (const auto &plane : planes) {
+                glm::vec3 normal{plane};
+                glm::vec3 farCorner = glm::mix(node.bounds.min, node.bounds.max, glm::greaterThanEqual(normal, glm::vec3{0.f}));
+                if (glm::dot(normal, farCorner) + plane.w < 0.f) {
+                    outside = true;
+                    break;
+                }
+                glm::vec3 nearCorner = glm::mix(node.bounds.max, node.bounds.min, glm::greaterThanEqual(normal, glm::vec3{0.f}));
+                if (glm::dot(normal, nearCorner) + plane.w < 0.f) {
+                    inside = false;
+                }
+            }
+            if (outside) continue;
+            if (inside) {
+                collectSubtree(nodeIndex, ids);
+                continue;
+            }
+
+            if (node.count > 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                    const glm::vec4 &sphere = spheres.valueAt(primitives[i]);
+                    bool sphereInside = true;
+                    for (const auto &plane : planes) {
+                        if (glm::dot(glm::vec3{plane}, glm::vec3{sphere}) + plane.w < -sphere.w) {
+                            sphereInside = false;
+                            break;
+                        }
+                    }
+                    if (sphereInside) ids.push_back(spheres.ids()[primitives[i]]);
+                }
+            } else {
+                stack[top++] = node.first;
+                stack[top++] = node.first + 1;
+            }
+        }
+    }
+
+    void LveBvh::querySphere(const glm::vec3 &center, float radius, std::vector<uint32_t> &ids) const {
+        if (nodes.empty()) return;
+        assert(!needsRebuild && movedPrimitives.empty() && "Call update before querying");
+
+        uint32_t stack[MAX_DEPTH + 1];
+        uint32_t top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &node = nodes[stack[--top]];
+            glm::vec3 offset = glm::clamp(center, node.bounds.min, node.bounds.max) - center;
+            if (glm::dot(offset, offset) > radius * radius) continue;
+
+            if (node.count > 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                    const glm::vec4 &sphere = spheres.valueAt(primitives[i]);
+                    glm::vec3 between = glm::vec3{sphere} - center;
+                    float reach = sphere.w + radius;
+                    if (glm::dot(between, between) <= reach * reach) {
+                        ids.push_back(spheres.ids()[primitives[i]]);
+                    }
+                }
+            } else {
+                stack[top++] = node.first;
+                stack[top++] = node.first + 1;
+            }
+        }
+    }
+
+    bool LveBvh::raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, Hit &hit) const {
+        if (nodes.empty()) return false;
+        assert(!needsRebuild && movedPrimitives.empty() && "Call update before querying");
+
+        glm::vec3 inverseDirection = 1.f / direction;
+        // Entry distance along the ray, or FLT_MAX if the box is missed or beyond the best hit.
+        auto enter = [&](const Bounds &bounds, float best) {
+            glm::vec3 t1 = (bounds.min - origin) * inverseDirection;
+            glm::vec3 t2 = (bounds.max - origin) * inverseDirection;
+            glm::vec3 near = glm::min(t1, t2);
+            glm::vec3 far = glm::max(t1, t2);
+            float tNear = std::max(std::max(near.x, near.y), std::max(near.z, 0.f));
+            float tFar = std::min(std::min(far.x, far.y), far.z);
+            return tNear <= tFar && tNear < best ? tNear : FLT_MAX;
+        };
+
+        float best = maxDistance;
+        bool found = false;
+        uint32_t stack[MAX_DEPTH + 1];
+        uint32_t top = 0;
+        if (enter(nodes[0].bounds, best) == FLT_MAX) return false;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &node = nodes[stack[--top]];
+            if (node.count > 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                    const glm::vec4 &sphere = spheres.valueAt(primitives[i]);
+                    glm::vec3 toOrigin = origin - glm::vec3{sphere};
+                    float b = glm::dot(toOrigin, direction);
+                    float c = glm::dot(toOrigin, toOrigin) - sphere.w * sphere.w;
+                    float discriminant = b * b - c;
+                    if (discriminant < 0.f) continue;
+                    float root = std::sqrt(discriminant);
+                    float t = -b - root < 0.f ? -b + root : -b - root;  // from inside, the exit
+                    if (t >= 0.f && t < best) {
+                        best = t;
+                        hit.id = spheres.ids()[primitives[i]];
+                        hit.distance = t;
+                        found = true;
+                    }
+                }
+                continue;
+            }
+
+            // Visit the nearer child first, so it can shrink best before the other is entered.
+            float leftEnter = enter(nodes[node.first].bounds, best);
+            float rightEnter = enter(nodes[node.first + 1].bounds, best);
+            uint32_t nearChild = leftEnter <= rightEnter ? node.first : node.first + 1;
+            uint32_t farChild = leftEnter <= rightEnter ? node.first + 1 : node.first;
+            if (std::max(leftEnter, rightEnter) != FLT_MAX) stack[top++] = farChild;
+            if (std::min(leftEnter, rightEnter) != FLT_MAX) stack[top++] = nearChild;
+        }
+        return found;
+    }
+
+    void LveBvh::runBenchmark(std::ostream &out, const std::array<glm::vec4, 6> &frustumPlanes) {
+        using Clock = std::chrono::high_resolution_clock;
+        auto milliseconds = [](Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        };
+        constexpr int QUERY_COUNT = 100;
+
+        std::mt19937 random{1234};
+        for (uint32_t count : {1000u, 10000u, 100000u}) {
+            // Constant density: the scene grows with the object count.
+            float halfExtent = 2.f * std::cbrt(static_cast<float>(count));
+            std::uniform_real_distribution<float> position{-halfExtent, halfExtent};
+            std::uniform_real_distribution<float> radius{0.1f, 0.5f};
+
+            LveBvh bvh;
+            std::vector<glm::vec4> brute;
+            for (uint32_t id = 0; id < count; id++) {
+                glm::vec4 sphere{position(random), position(random), position(random), radius(random)};
+                bvh.set(id, glm::vec3{sphere}, sphere.w);
+                brute.push_back(sphere);
+            }
+            auto start = Clock::now();
+            bvh.update();
+            double buildTime = milliseconds(start);
+
+            std::vector<uint32_t> ids;
+            start = Clock::now();
+            bvh.queryFrustum(frustumPlanes, ids);
+            double frustumTime = milliseconds(start);
+            size_t frustumVisible = ids.size();
+            ids.clear();
+            start = Clock::now();
+            for (uint32_t id = 0; id < count; id++) {
+                bool inside = true;
+                for (const auto &plane : frustumPlanes) {
+                    if (glm::dot(glm::vec3{plane}, glm::vec3{brute[id]}) + plane.w < -brute[id].w) {
+                        inside = false;
+                        break;
+                    }
+                }
+                if (inside) ids.push_back(id);
+            }
+            double frustumBruteTime = milliseconds(start);
+
+            std::vector<glm::vec3> queryPoints;
+            std::vector<glm::vec3> queryDirections;
+            for (int q = 0; q < QUERY_COUNT; q++) {
+                queryPoints.emplace_back(position(random), position(random), position(random));
+                glm::vec3 direction{position(random), position(random), position(random)};
+                queryDirections.push_back(glm::normalize(direction + glm::vec3{1e-3f}));
+            }
+
+            ids.clear();
+            start = Clock::now();
+            for (const auto &point : queryPoints) bvh.querySphere(point, 2.f, ids);
+            double sphereTime = milliseconds(start);
+            ids.clear();
+            start = Clock::now();
+            for (const auto &point : queryPoints) {
+                for (uint32_t id = 0; id < count; id++) {
+                    glm::vec3 between = glm::vec3{brute[id]} - point;
+                    float reach = brute[id].w + 2.f;
+                    if (glm::dot(between, between) <= reach * reach) ids.push_back(id);
+                }
+            }
+            double sphereBruteTime = milliseconds(start);
+
+            int hits = 0;
+            start = Clock::now();
+            for (int q = 0; q < QUERY_COUNT; q++) {
+                Hit hit;
+                hits += bvh.raycast(queryPoints[q], queryDirections[q], FLT_MAX, hit) ? 1 : 0;
+            }
+            double rayTime = milliseconds(start);
+            start = Clock::now();
+            for (int q = 0; q < QUERY_COUNT; q++) {
+                float best = FLT_MAX;
+                for (uint32_t id = 0; id < count; id++) {
+                    glm::vec3 toOrigin = queryPoints[q] - glm::vec3{brute[id]};
+                    float b = glm::dot(toOrigin, queryDirections[q]);
+                    float c = glm::dot(toOrigin, toOrigin) - brute[id].w * brute[id].w;
+                    float discriminant = b * b - c;
+                    if (discriminant < 0.f) continue;
+                    float t = -b - std::sqrt(discriminant);
+                    if (t < 0.f) t = -b + std::sqrt(discriminant);
+                    if (t >= 0.f && t < best) best = t;
+                }
+            }
+            double rayBruteTime = milliseconds(start);
+
+            out << "bvh " << count << " objects: build " << buildTime << " ms, frustum (" << frustumVisible
+                << " visible) " << frustumTime << " vs " << frustumBruteTime << " ms brute force, "
+                << QUERY_COUNT << " sphere queries " << sphereTime << " vs " << sphereBruteTime << " ms, "
+                << QUERY_COUNT << " rays (" << hits << " hits) " << rayTime << " vs " << rayBruteTime << " ms"
+                << std::endl;
+        }
+    }
+}
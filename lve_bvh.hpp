@@ -0,0 +1,108 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_BVH_HPP
+#define VULKANTEST_LVE_BVH_HPP
+
+#include "lve_sparse_set.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cfloat>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace lve {
+
+    // Bounding volume hierarchy over world space bounding spheres, keyed by object id. The tree
+    // is built top down with a binned surface area heuristic. Moving objects only refit the
+    // boxes on the path from their leaf to the root, and the tree is rebuilt once its SAH cost
+    // has drifted past REBUILD_COST_RATIO times the cost it had when built, or objects were
+    // added or removed.
+    class LveBvh {
+    public:
+        struct Hit {
+            uint32_t id = 0;
+            float distance = 0.f;
+        };
+
+        static constexpr uint32_t MAX_LEAF_SIZE = 4;
+        static constexpr float REBUILD_COST_RATIO = 1.5f;
+
+        void clear();
+        // Adds the object, or moves it if it is already in the tree.
+        void set(uint32_t id, const glm::vec3 &center, float radius);
+        void set(uint32_t id, const glm::vec4 &sphere) { set(id, glm::vec3{sphere}, sphere.w); }
+        void remove(uint32_t id);
+        bool contains(uint32_t id) const { return spheres.contains(id); }
+        size_t size() const { return spheres.size(); }
+
+        // Applies the set and remove calls since the last update, by refitting or rebuilding.
+        void update();
+
+        // Append the ids of the objects whose sphere is at least partly inside the frustum (planes
+        // as from LveCamera::getFrustumPlanes), or overlaps the given sphere.
+        void queryFrustum(const std::array<glm::vec4, 6> &planes, std::vector<uint32_t> &ids) const;
+        void querySphere(const glm::vec3 &center, float radius, std::vector<uint32_t> &ids) const;
+        // Nearest object whose sphere the ray hits within maxDistance; direction must be normalized.
+        bool raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, Hit &hit) const;
+
+        float getCost() const { return cost; }
+        uint32_t getRebuildCount() const { return rebuildCount; }
+
+        // Times building and the three queries against brute force loops over 1k, 10k and 100k
+        // random spheres, and writes one line per size.
+        static void runBenchmark(std::ostream &out, const std::array<glm::vec4, 6> &frustumPlanes);
+
+    private:
+        static constexpr uint32_t INVALID_NODE = UINT32_MAX;
+        static constexpr uint32_t SAH_BINS = 12;
+        static constexpr uint32_t MAX_DEPTH = 64;
+
+        struct Bounds {
+            glm::vec3 min{FLT_MAX};
+            glm::vec3 max{-FLT_MAX};
+
+            void grow(const Bounds &other);
+            void grow(const glm::vec3 &point);
+            float area() const;
+        };
+
+        // Interior nodes have count 0 and their children at first and first + 1; leaves hold
+        // primitives[first, first + count). Children always come after their parent.
+        struct Node {
+            Bounds bounds;
+            uint32_t first = 0;
+            uint32_t count = 0;
+            uint32_t parent = INVALID_NODE;
+        };
+
+        static Bounds sphereBounds(const glm::vec4 &sphere);
+        void build();
+        bool subdivide(uint32_t nodeIndex, uint32_t depth);
+        void refit();
+        double computeCostSum() const;
+        double nodeCost(const Node &node) const;
+        void collectSubtree(uint32_t nodeIndex, std::vector<uint32_t> &ids) const;
+
+        LveSparseSet<glm::vec4> spheres;   // xyz center, w radius, keyed by object id
+        std::vector<Node> nodes;
+        std::vector<uint32_t> primitives;  // dense sphere indices, grouped by leaf
+        std::vector<uint32_t> primitiveLeaf;
+        std::vector<glm::vec3> centroids;  // per dense sphere index, during a build
+        std::vector<uint32_t> movedPrimitives;
+        bool needsRebuild = false;
+        double costSum = 0.0;  // sum of node areas weighted by traversal or intersection count
+        float builtCost = 0.f;
+        float cost = 0.f;      // costSum over the root area
+        uint32_t rebuildCount = 0;
+    };
+}
+
+#endif //VULKANTEST_LVE_BVH_HPP
@@ -9,6 +9,8 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <array>
+
 namespace lve {
     class LveCamera {
     public:
@@ -25,6 +27,10 @@ namespace lve {
         const glm::mat4& getInverseView() const { return inverseViewMatrix; }
         const glm::vec3 getCameraPos() const { return glm::vec3(inverseViewMatrix[3]); }
 
+        // World space planes (xyz normal pointing inwards, w distance) in the order left, right,
+        // bottom, top, near, far. A point p is inside when dot(plane.xyz, p) + plane.w >= 0.
+        std::array<glm::vec4, 6> getFrustumPlanes() const;
+
     private:
         glm::mat4 projectionMatrix{1.f};
         glm::mat4 viewMatrix{1.f};
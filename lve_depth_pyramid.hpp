@@ -0,0 +1,87 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_DEPTH_PYRAMID_HPP
+#define VULKANTEST_LVE_DEPTH_PYRAMID_HPP
+
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lve {
+
+    // Hierarchical depth (Hi-Z) buffer for occlusion culling. Level 0 is the depth buffer reduced
+    // to the largest power of two size that fits in it, and every further level holds the farthest
+    // depth of the 2x2 texels below it, so a screen rectangle can be tested against the one level
+    // where it covers at most 2x2 texels. The levels are built by depth_pyramid.comp.
+    class LveDepthPyramid {
+    public:
+        LveDepthPyramid(LveDevice &device, VkExtent2D depthExtent);
+        ~LveDepthPyramid();
+
+        LveDepthPyramid(const LveDepthPyramid&) = delete;
+        LveDepthPyramid &operator=(const LveDepthPyramid&) = delete;
+
+        // Recreates the pyramid when the depth buffer size changed, waiting for the device to go
+        // idle first, so call it before anything using the pyramid is recorded for the frame.
+        void resize(VkExtent2D depthExtent);
+
+        // Records the reduction of the depth image into the pyramid; must be recorded outside a
+        // render pass. The depth image is expected, and left, in
+        // VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL.
+        void build(VkCommandBuffer commandBuffer, int frameIndex, VkImage depthImage, VkImageView depthImageView,
+                   VkFormat depthFormat);
+
+        // All levels, for a combined image sampler read with texelFetch.
+        VkDescriptorImageInfo descriptorInfo() const;
+        VkExtent2D getExtent() const { return extent; }
+        uint32_t getLevelCount() const { return levelCount; }
+        // Goes up whenever the image is recreated, so descriptor sets referencing it can be rewritten.
+        uint32_t getVersion() const { return version; }
+
+    private:
+        static constexpr uint32_t WORKGROUP_SIZE = 8;  // local_size_x and _y of depth_pyramid.comp
+
+        struct PushConstants {
+            uint32_t sourceWidth;
+            uint32_t sourceHeight;
+            uint32_t width;
+            uint32_t height;
+        };
+
+        void createPipeline();
+        void createSampler();
+        void createImage();
+        void destroyImage();
+
+        LveDevice &lveDevice;
+        std::unique_ptr<LveDescriptorSetLayout> setLayout;
+        std::unique_ptr<LveDescriptorPool> descriptorPool;
+        VkPipelineLayout pipelineLayout;
+        std::unique_ptr<LvePipeline> pipeline;
+        VkSampler sampler;
+
+        VkExtent2D depthExtent;
+        VkExtent2D extent{};
+        uint32_t levelCount = 0;
+        uint32_t version = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+        VkImageView imageView = VK_NULL_HANDLE;
+        std::vector<VkImageView> levelViews;
+        std::vector<VkDescriptorSet> levelSets;  // level i > 0 reads level i - 1
+        // Level 0 reads the depth image of the swap chain image in use, so each frame in flight
+        // has its own set, rewritten when the frame is recorded.
+        std::array<VkDescriptorSet, LveSwapChain::MAX_FRAMES_IN_FLIGHT> depthSets{};
+    };
+}
+
+#endif //VULKANTEST_LVE_DEPTH_PYRAMID_HPP
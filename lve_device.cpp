@@ -1,7 +1,11 @@
 #include "lve_device.hpp"
 
 // std headers
+#include <algorithm>
+#include <cassert>
 #include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -54,9 +58,30 @@ namespace lve {
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        createTransferCommandPool();
+        pipelineCache_ = std::make_unique<LvePipelineCache>(device_, properties, PIPELINE_CACHE_PATH);
+        shaderModules_ = std::make_unique<LveShaderModuleCache>(device_);
     }
 
     LveDevice::~LveDevice() {
+        vkDeviceWaitIdle(device_);
+        shaderModules_.reset();
+        pipelineCache_.reset();
+        for (auto &transfer: pendingTransfers) {
+            vkDestroySemaphore(device_, transfer.semaphore, nullptr);
+            vkDestroyFence(device_, transfer.fence, nullptr);
+        }
+        for (auto &transfer: acquiredTransfers) {
+            vkDestroyFence(device_, transfer.fence, nullptr);
+        }
+        for (auto semaphore: acquiredSemaphores) {
+            vkDestroySemaphore(device_, semaphore, nullptr);
+        }
+        for (auto semaphore: freeTransferSemaphores) {
+            vkDestroySemaphore(device_, semaphore, nullptr);
+        }
+
+        vkDestroyCommandPool(device_, transferCommandPool, nullptr);
         vkDestroyCommandPool(device_, commandPool, nullptr);
         vkDestroyDevice(device_, nullptr);
 
@@ -79,13 +104,35 @@ namespace lve {
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // Vulkan 1.1 when the loader has it; buffer device addresses need its features2 and allocate flags.
+        auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr(
+            nullptr,
+            "vkEnumerateInstanceVersion");
+        uint32_t loaderVersion = VK_API_VERSION_1_0;
+        if (enumerateInstanceVersion != nullptr) {
+            enumerateInstanceVersion(&loaderVersion);
+        }
+        instanceApiVersion = loaderVersion >= VK_API_VERSION_1_1 ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0;
+        appInfo.apiVersion = instanceApiVersion;
 
         VkInstanceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
         createInfo.pApplicationInfo = &appInfo;
 
         auto extensions = getRequiredExtensions();
+
+        // Optional, needed to query VK_EXT_memory_budget from a Vulkan 1.0 instance.
+        uint32_t availableCount = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(availableCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, availableExtensions.data());
+        for (const auto &extension: availableExtensions) {
+            if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+                extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+                physicalDeviceProperties2Enabled = true;
+            }
+        }
+
         createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
         createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -130,14 +177,18 @@ namespace lve {
         }
 
         vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
         std::cout << "physical device: " << properties.deviceName << std::endl;
     }
 
     void LveDevice::createLogicalDevice() {
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        graphicsFamilyIndex = indices.graphicsFamily;
+        dedicatedTransfer = indices.transferFamilyHasValue;
+        transferFamilyIndex = dedicatedTransfer ? indices.transferFamily : indices.graphicsFamily;
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily, transferFamilyIndex};
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily: uniqueQueueFamilies) {
@@ -149,8 +200,20 @@ namespace lve {
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        // Optional, GPU driven rendering needs indirect draws with a non-zero firstInstance.
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+        drawIndirectFirstInstanceEnabled = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
+        // Optional, only used to measure shading work. A query can only stay active while
+        // secondary command buffers execute with inherited queries.
+        pipelineStatisticsEnabled = supportedFeatures.pipelineStatisticsQuery == VK_TRUE &&
+                                    supportedFeatures.inheritedQueries == VK_TRUE;
+        deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsEnabled ? VK_TRUE : VK_FALSE;
+        deviceFeatures.inheritedQueries = pipelineStatisticsEnabled ? VK_TRUE : VK_FALSE;
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -158,9 +221,35 @@ namespace lve {
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+        enabledDeviceExtensions = deviceExtensions;
+        if (physicalDeviceProperties2Enabled &&
+            isDeviceExtensionSupported(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+            enabledDeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            memoryBudgetEnabled = true;
+        }
+
+        VkPhysicalDeviceBufferDeviceAddressFeaturesKHR bufferDeviceAddressFeatures{};
+        bufferDeviceAddressFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR;
+        if (instanceApiVersion >= VK_API_VERSION_1_1 && properties.apiVersion >= VK_API_VERSION_1_1 &&
+            isDeviceExtensionSupported(physicalDevice, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME)) {
+            VkPhysicalDeviceFeatures2 features2{};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features2.pNext = &bufferDeviceAddressFeatures;
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+            if (bufferDeviceAddressFeatures.bufferDeviceAddress) {
+                // Only the core feature is wanted, not capture/replay or multi-device addresses.
+                bufferDeviceAddressFeatures.bufferDeviceAddressCaptureReplay = VK_FALSE;
+                bufferDeviceAddressFeatures.bufferDeviceAddressMultiDevice = VK_FALSE;
+                enabledDeviceExtensions.push_back(VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
+                createInfo.pNext = &bufferDeviceAddressFeatures;
+                bufferDeviceAddressEnabled = true;
+            }
+        }
+
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledDeviceExtensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -175,8 +264,20 @@ namespace lve {
             throw std::runtime_error("failed to create logical device!");
         }
 
+        if (bufferDeviceAddressEnabled) {
+            vkGetBufferDeviceAddressKHR_ = (PFN_vkGetBufferDeviceAddressKHR) vkGetDeviceProcAddr(
+                device_,
+                "vkGetBufferDeviceAddressKHR");
+            bufferDeviceAddressEnabled = vkGetBufferDeviceAddressKHR_ != nullptr;
+        }
+        std::cout << "buffer device address: " << (bufferDeviceAddressEnabled ? "supported" : "unsupported")
+                  << std::endl;
+
         vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
         vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+        vkGetDeviceQueue(device_, transferFamilyIndex, 0, &transferQueue_);
+        std::cout << "transfer queue family: " << transferFamilyIndex
+                  << (dedicatedTransfer ? " (dedicated)" : " (shared with graphics)") << std::endl;
     }
 
     void LveDevice::createCommandPool() {
@@ -193,6 +294,18 @@ namespace lve {
         }
     }
 
+    void LveDevice::createTransferCommandPool() {
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = transferFamilyIndex;
+        poolInfo.flags =
+            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+        if (vkCreateCommandPool(device_, &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create transfer command pool!");
+        }
+    }
+
     void LveDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
 
     bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
@@ -317,6 +430,25 @@ namespace lve {
         return requiredExtensions.empty();
     }
 
+    bool LveDevice::isDeviceExtensionSupported(VkPhysicalDevice device, const char *extensionName) {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(
+            device,
+            nullptr,
+            &extensionCount,
+            availableExtensions.data());
+
+        for (const auto &extension: availableExtensions) {
+            if (strcmp(extension.extensionName, extensionName) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device) {
         QueueFamilyIndices indices;
 
@@ -345,6 +477,24 @@ namespace lve {
             i++;
         }
 
+        // Prefer a transfer-only family (the DMA/copy engine on discrete GPUs), otherwise take any
+        // family without graphics support so uploads don't serialize with rendering.
+        for (uint32_t family = 0; family < queueFamilyCount; family++) {
+            const auto &queueFamily = queueFamilies[family];
+            if (queueFamily.queueCount == 0 || !(queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) ||
+                (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+                continue;
+            }
+            bool transferOnly = !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT);
+            if (!indices.transferFamilyHasValue || transferOnly) {
+                indices.transferFamily = family;
+                indices.transferFamilyHasValue = true;
+            }
+            if (transferOnly) {
+                break;
+            }
+        }
+
         return indices;
     }
 
@@ -391,11 +541,9 @@ namespace lve {
     }
 
     uint32_t LveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
             if ((typeFilter & (1 << i)) &&
-                (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
                 return i;
             }
         }
@@ -403,12 +551,50 @@ namespace lve {
         throw std::runtime_error("failed to find suitable memory type!");
     }
 
+    uint32_t LveDevice::findMemoryType(
+        uint32_t typeFilter, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferredProperties) {
+        auto countBits = [](VkMemoryPropertyFlags flags) {
+            int count = 0;
+            for (; flags != 0; flags &= flags - 1) count++;
+            return count;
+        };
+
+        // Ties go to the lower index, drivers list the types they prefer first.
+        int bestScore = -1;
+        uint32_t bestIndex = 0;
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+            if (!(typeFilter & (1 << i)) || (flags & properties) != properties) continue;
+            int score = countBits(flags & preferredProperties);
+            if (score > bestScore) {
+                bestScore = score;
+                bestIndex = i;
+            }
+        }
+
+        if (bestScore < 0) {
+            throw std::runtime_error("failed to find suitable memory type!");
+        }
+        return bestIndex;
+    }
+
     void LveDevice::createBuffer(
         VkDeviceSize size,
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer &buffer,
         VkDeviceMemory &bufferMemory) {
+        createBuffer(size, usage, properties, buffer, bufferMemory, memoryCategoryForUsage(usage));
+    }
+
+    VkMemoryPropertyFlags LveDevice::createBuffer(
+        VkDeviceSize size,
+        VkBufferUsageFlags usage,
+        VkMemoryPropertyFlags properties,
+        VkBuffer &buffer,
+        VkDeviceMemory &bufferMemory,
+        LveMemoryCategory category,
+        VkMemoryPropertyFlags preferredProperties) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
@@ -425,13 +611,30 @@ namespace lve {
         VkMemoryAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
         allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties, preferredProperties);
+
+        VkMemoryAllocateFlagsInfo allocFlagsInfo{};
+        if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR) {
+            assert(bufferDeviceAddressEnabled && "Buffer device address is not supported by this device");
+            allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+            allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT_KHR;
+            allocInfo.pNext = &allocFlagsInfo;
+        }
 
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+        if (allocateMemory(allocInfo, category, bufferMemory) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate vertex buffer memory!");
         }
 
         vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+        return getMemoryTypeProperties(allocInfo.memoryTypeIndex);
+    }
+
+    VkDeviceAddress LveDevice::getBufferDeviceAddress(VkBuffer buffer) {
+        assert(bufferDeviceAddressEnabled && "Buffer device address is not supported by this device");
+        VkBufferDeviceAddressInfoKHR addressInfo{};
+        addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR;
+        addressInfo.buffer = buffer;
+        return vkGetBufferDeviceAddressKHR_(device_, &addressInfo);
     }
 
     VkCommandBuffer LveDevice::beginSingleTimeCommands() {
@@ -466,21 +669,250 @@ namespace lve {
         vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
     }
 
-    void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+    VkCommandBuffer LveDevice::beginTransferCommands() {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = transferCommandPool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        return commandBuffer;
+    }
+
+    VkSemaphore LveDevice::getTransferSemaphore() {
+        if (!freeTransferSemaphores.empty()) {
+            VkSemaphore semaphore = freeTransferSemaphores.back();
+            freeTransferSemaphores.pop_back();
+            return semaphore;
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        VkSemaphore semaphore;
+        if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create transfer semaphore!");
+        }
+        return semaphore;
+    }
+
+    void LveDevice::submitTransfer(VkCommandBuffer commandBuffer, PendingTransfer &transfer) {
+        vkEndCommandBuffer(commandBuffer);
+        transfer.commandBuffer = commandBuffer;
+        transfer.semaphore = getTransferSemaphore();
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(device_, &fenceInfo, nullptr, &transfer.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create transfer fence!");
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &transfer.semaphore;
+
+        if (vkQueueSubmit(transferQueue_, 1, &submitInfo, transfer.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit transfer command buffer!");
+        }
+    }
+
+    // Blocks until the transfer is finished and owned by the graphics queue.
+    void LveDevice::waitForTransfer(PendingTransfer &transfer) {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            transfer.dstStageMask,
+            transfer.dstStageMask,
+            0,
+            0, nullptr,
+            static_cast<uint32_t>(transfer.bufferAcquires.size()), transfer.bufferAcquires.data(),
+            static_cast<uint32_t>(transfer.imageAcquires.size()), transfer.imageAcquires.data());
+        vkEndCommandBuffer(commandBuffer);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &transfer.semaphore;
+        submitInfo.pWaitDstStageMask = &transfer.dstStageMask;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueWaitIdle(graphicsQueue_);
+        vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+
+        vkWaitForFences(device_, 1, &transfer.fence, VK_TRUE, UINT64_MAX);
+        vkDestroyFence(device_, transfer.fence, nullptr);
+        vkFreeCommandBuffers(device_, transferCommandPool, 1, &transfer.commandBuffer);
+        freeTransferSemaphores.push_back(transfer.semaphore);
+    }
 
+    void LveDevice::collectFinishedTransfers() {
+        auto finished = [this](PendingTransfer &transfer) {
+            if (vkGetFenceStatus(device_, transfer.fence) != VK_SUCCESS) {
+                return false;
+            }
+            vkDestroyFence(device_, transfer.fence, nullptr);
+            vkFreeCommandBuffers(device_, transferCommandPool, 1, &transfer.commandBuffer);
+            return true;
+        };
+        acquiredTransfers.erase(
+            std::remove_if(acquiredTransfers.begin(), acquiredTransfers.end(), finished),
+            acquiredTransfers.end());
+    }
+
+    void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
         VkBufferCopy copyRegion{};
         copyRegion.srcOffset = 0;  // Optional
         copyRegion.dstOffset = 0;  // Optional
         copyRegion.size = size;
+
+        if (!dedicatedTransfer) {
+            VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+            vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+            endSingleTimeCommands(commandBuffer);
+            return;
+        }
+
+        VkCommandBuffer commandBuffer = beginTransferCommands();
+        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex = transferFamilyIndex;
+        barrier.dstQueueFamilyIndex = graphicsFamilyIndex;
+        barrier.buffer = dstBuffer;
+        barrier.offset = 0;
+        barrier.size = size;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        PendingTransfer transfer{};
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        transfer.bufferAcquires.push_back(barrier);
+
+        submitTransfer(commandBuffer, transfer);
+        waitForTransfer(transfer);
+    }
+
+    void LveDevice::copyBufferAsync(
+        VkBuffer srcBuffer,
+        VkBuffer dstBuffer,
+        VkDeviceSize size,
+        VkAccessFlags dstAccessMask,
+        VkPipelineStageFlags dstStageMask,
+        std::shared_ptr<void> keepAlive) {
+        collectFinishedTransfers();
+
+        VkCommandBuffer commandBuffer = beginTransferCommands();
+
+        VkBufferCopy copyRegion{};
+        copyRegion.size = size;
         vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-        endSingleTimeCommands(commandBuffer);
+        PendingTransfer transfer{};
+        transfer.dstStageMask = dstStageMask;
+        transfer.keepAlive = std::move(keepAlive);
+
+        // Without a dedicated family the semaphore alone orders the copy before the frame.
+        if (dedicatedTransfer) {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.srcQueueFamilyIndex = transferFamilyIndex;
+            barrier.dstQueueFamilyIndex = graphicsFamilyIndex;
+            barrier.buffer = dstBuffer;
+            barrier.offset = 0;
+            barrier.size = size;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = dstAccessMask;
+            transfer.bufferAcquires.push_back(barrier);
+        }
+
+        submitTransfer(commandBuffer, transfer);
+        pendingTransfers.push_back(std::move(transfer));
+    }
+
+    void LveDevice::acquirePendingTransfers(
+        VkCommandBuffer commandBuffer,
+        std::vector<VkSemaphore> &waitSemaphores,
+        std::vector<VkPipelineStageFlags> &waitStages) {
+        collectFinishedTransfers();
+
+        for (auto &transfer: pendingTransfers) {
+            if (!transfer.bufferAcquires.empty() || !transfer.imageAcquires.empty()) {
+                vkCmdPipelineBarrier(
+                    commandBuffer,
+                    transfer.dstStageMask,
+                    transfer.dstStageMask,
+                    0,
+                    0, nullptr,
+                    static_cast<uint32_t>(transfer.bufferAcquires.size()), transfer.bufferAcquires.data(),
+                    static_cast<uint32_t>(transfer.imageAcquires.size()), transfer.imageAcquires.data());
+            }
+            waitSemaphores.push_back(transfer.semaphore);
+            waitStages.push_back(transfer.dstStageMask);
+            acquiredSemaphores.push_back(transfer.semaphore);
+            transfer.semaphore = VK_NULL_HANDLE;
+            acquiredTransfers.push_back(std::move(transfer));
+        }
+        pendingTransfers.clear();
+    }
+
+    void LveDevice::releaseAcquiredTransferSemaphores() {
+        // A binary semaphore may be signaled again as soon as its wait has been submitted.
+        freeTransferSemaphores.insert(
+            freeTransferSemaphores.end(), acquiredSemaphores.begin(), acquiredSemaphores.end());
+        acquiredSemaphores.clear();
     }
 
     void LveDevice::copyBufferToImage(
         VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        bool useTransferQueue = dedicatedTransfer;
+        VkCommandBuffer commandBuffer = useTransferQueue ? beginTransferCommands() : beginSingleTimeCommands();
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = layerCount;
+
+        if (useTransferQueue) {
+            // The transfer family never owned the image, but coming from UNDEFINED discards the
+            // contents so no ownership transfer is required before the copy.
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
 
         VkBufferImageCopy region{};
         region.bufferOffset = 0;
@@ -502,14 +934,39 @@ namespace lve {
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             1,
             &region);
-        endSingleTimeCommands(commandBuffer);
+
+        if (!useTransferQueue) {
+            endSingleTimeCommands(commandBuffer);
+            return;
+        }
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = transferFamilyIndex;
+        barrier.dstQueueFamilyIndex = graphicsFamilyIndex;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        PendingTransfer transfer{};
+        transfer.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        transfer.imageAcquires.push_back(barrier);
+
+        submitTransfer(commandBuffer, transfer);
+        waitForTransfer(transfer);
     }
 
     void LveDevice::createImageWithInfo(
         const VkImageCreateInfo &imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage &image,
-        VkDeviceMemory &imageMemory) {
+        VkDeviceMemory &imageMemory,
+        LveMemoryCategory category) {
         if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
             throw std::runtime_error("failed to create image!");
         }
@@ -522,7 +979,7 @@ namespace lve {
         allocInfo.allocationSize = memRequirements.size;
         allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+        if (allocateMemory(allocInfo, category, imageMemory) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate image memory!");
         }
 
@@ -531,4 +988,134 @@ namespace lve {
         }
     }
 
+    VkResult LveDevice::allocateMemory(
+        const VkMemoryAllocateInfo &allocInfo, LveMemoryCategory category, VkDeviceMemory &memory) {
+        VkResult result = vkAllocateMemory(device_, &allocInfo, nullptr, &memory);
+        if (result == VK_SUCCESS) {
+            uint32_t heapIndex = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].heapIndex;
+            trackedAllocations[memory] = {allocInfo.allocationSize, heapIndex, category};
+        }
+        return result;
+    }
+
+    void LveDevice::freeMemory(VkDeviceMemory memory) {
+        trackedAllocations.erase(memory);
+        vkFreeMemory(device_, memory, nullptr);
+    }
+
+    LveMemoryCategory LveDevice::memoryCategoryForUsage(VkBufferUsageFlags usage) {
+        if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) return LveMemoryCategory::Vertex;
+        if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) return LveMemoryCategory::Index;
+        if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) return LveMemoryCategory::Uniform;
+        if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) return LveMemoryCategory::Storage;
+        if (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) return LveMemoryCategory::Staging;
+        return LveMemoryCategory::Other;
+    }
+
+    const char *LveDevice::memoryCategoryName(LveMemoryCategory category) {
+        switch (category) {
+            case LveMemoryCategory::Vertex: return "vertex";
+            case LveMemoryCategory::Index: return "index";
+            case LveMemoryCategory::Uniform: return "uniform";
+            case LveMemoryCategory::Storage: return "storage";
+            case LveMemoryCategory::Staging: return "staging";
+            case LveMemoryCategory::Texture: return "texture";
+            case LveMemoryCategory::Depth: return "depth";
+            default: return "other";
+        }
+    }
+
+    MemoryStats LveDevice::getMemoryStats() {
+        MemoryStats stats{};
+        stats.heaps.resize(memoryProperties.memoryHeapCount);
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            stats.heaps[i].size = memoryProperties.memoryHeaps[i].size;
+            stats.heaps[i].budget = memoryProperties.memoryHeaps[i].size;
+            stats.heaps[i].deviceLocal =
+                (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        }
+
+        for (const auto &kv: trackedAllocations) {
+            auto category = static_cast<size_t>(kv.second.category);
+            stats.categoryBytes[category] += kv.second.size;
+            stats.categoryAllocations[category]++;
+            stats.heaps[kv.second.heapIndex].engineUsage += kv.second.size;
+        }
+        for (auto &heap: stats.heaps) {
+            heap.usage = heap.engineUsage;
+        }
+
+        if (memoryBudgetEnabled) {
+            auto getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR) vkGetInstanceProcAddr(
+                instance,
+                "vkGetPhysicalDeviceMemoryProperties2KHR");
+            if (getMemoryProperties2 != nullptr) {
+                VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+                budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+                VkPhysicalDeviceMemoryProperties2KHR memoryProperties2{};
+                memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+                memoryProperties2.pNext = &budgetProperties;
+                getMemoryProperties2(physicalDevice, &memoryProperties2);
+
+                for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+                    stats.heaps[i].usage = budgetProperties.heapUsage[i];
+                    stats.heaps[i].budget = budgetProperties.heapBudget[i];
+                }
+                stats.budgetAvailable = true;
+            }
+        }
+        return stats;
+    }
+
+    void LveDevice::printMemoryStats(std::ostream &out) {
+        auto stats = getMemoryStats();
+        auto mib = [](VkDeviceSize bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+
+        out << std::fixed << std::setprecision(2);
+        out << "GPU memory (" << (stats.budgetAvailable ? "VK_EXT_memory_budget" : "no budget extension")
+            << "):" << std::endl;
+        for (size_t i = 0; i < stats.heaps.size(); i++) {
+            const auto &heap = stats.heaps[i];
+            out << "\theap " << i << (heap.deviceLocal ? " (device local)" : " (host)")
+                << ": usage " << mib(heap.usage) << " MiB / budget " << mib(heap.budget)
+                << " MiB, engine " << mib(heap.engineUsage) << " MiB, size " << mib(heap.size) << " MiB"
+                << std::endl;
+        }
+        for (size_t i = 0; i < stats.categoryBytes.size(); i++) {
+            if (stats.categoryAllocations[i] == 0) continue;
+            out << "\t" << memoryCategoryName(static_cast<LveMemoryCategory>(i)) << ": "
+                << stats.categoryAllocations[i] << " allocations, " << mib(stats.categoryBytes[i]) << " MiB"
+                << std::endl;
+        }
+        out << std::defaultfloat;
+    }
+
+    void LveDevice::writeMemoryStatsJson(const std::string &filepath) {
+        auto stats = getMemoryStats();
+        std::ofstream file{filepath, std::ios::trunc};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+
+        file << "{\n  \"budgetAvailable\": " << (stats.budgetAvailable ? "true" : "false") << ",\n";
+        file << "  \"heaps\": [\n";
+        for (size_t i = 0; i < stats.heaps.size(); i++) {
+            const auto &heap = stats.heaps[i];
+            file << "    {\"index\": " << i
+                 << ", \"deviceLocal\": " << (heap.deviceLocal ? "true" : "false")
+                 << ", \"size\": " << heap.size
+                 << ", \"usage\": " << heap.usage
+                 << ", \"budget\": " << heap.budget
+                 << ", \"engineUsage\": " << heap.engineUsage << "}"
+                 << (i + 1 < stats.heaps.size() ? "," : "") << "\n";
+        }
+        file << "  ],\n  \"categories\": {\n";
+        for (size_t i = 0; i < stats.categoryBytes.size(); i++) {
+            file << "    \"" << memoryCategoryName(static_cast<LveMemoryCategory>(i)) << "\": {\"allocations\": "
+                 << stats.categoryAllocations[i] << ", \"bytes\": " << stats.categoryBytes[i] << "}"
+                 << (i + 1 < stats.categoryBytes.size() ? "," : "") << "\n";
+        }
+        file << "  }\n}\n";
+    }
+
 }  // namespace lve
\ No newline at end of file
@@ -1,9 +1,15 @@
 #pragma once
 
+#include "lve_pipeline_cache.hpp"
+#include "lve_shader_module_cache.hpp"
 #include "lve_window.hpp"
 
 // std lib headers
+#include <array>
+#include <memory>
+#include <ostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace lve {
@@ -17,12 +23,55 @@ namespace lve {
     struct QueueFamilyIndices {
         uint32_t graphicsFamily;
         uint32_t presentFamily;
+        uint32_t transferFamily;
         bool graphicsFamilyHasValue = false;
         bool presentFamilyHasValue = false;
+        bool transferFamilyHasValue = false;  // Only set for a family without graphics support.
 
         bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
     };
 
+    // What a block of device memory is used for, so memory reports can break usage down.
+    enum class LveMemoryCategory {
+        Vertex,
+        Index,
+        Uniform,
+        Storage,
+        Staging,
+        Texture,
+        Depth,
+        Other,
+        Count
+    };
+
+    struct MemoryHeapStats {
+        VkDeviceSize size = 0;
+        VkDeviceSize engineUsage = 0;  // sum of the allocations made through LveDevice
+        VkDeviceSize usage = 0;        // whole process usage from VK_EXT_memory_budget, else engineUsage
+        VkDeviceSize budget = 0;       // VK_EXT_memory_budget estimate, else the heap size
+        bool deviceLocal = false;
+    };
+
+    struct MemoryStats {
+        std::array<VkDeviceSize, static_cast<size_t>(LveMemoryCategory::Count)> categoryBytes{};
+        std::array<uint32_t, static_cast<size_t>(LveMemoryCategory::Count)> categoryAllocations{};
+        std::vector<MemoryHeapStats> heaps;
+        bool budgetAvailable = false;
+    };
+
+    // An upload submitted to the transfer queue. The graphics queue still has to wait on the
+    // semaphore (and acquire ownership of the destination when the transfer family differs from
+    // the graphics family) before the destination may be used.
+    struct PendingTransfer {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        std::vector<VkBufferMemoryBarrier> bufferAcquires;
+        std::vector<VkImageMemoryBarrier> imageAcquires;
+        std::shared_ptr<void> keepAlive;  // e.g. the staging buffer, released once the copy is done.
+    };
+
     class LveDevice {
     public:
 #ifdef NDEBUG
@@ -30,6 +79,7 @@ namespace lve {
 #else
         const bool enableValidationLayers = true;
 #endif
+        static constexpr const char *PIPELINE_CACHE_PATH = "pipeline_cache.bin";
 
         LveDevice(LveWindow &window);
 
@@ -54,12 +104,25 @@ namespace lve {
 
         VkQueue presentQueue() { return presentQueue_; }
 
+        // Falls back to the graphics queue when the device has no transfer-only queue family.
+        VkQueue transferQueue() { return transferQueue_; }
+
+        bool hasDedicatedTransferQueue() const { return dedicatedTransfer; }
+
         VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
 
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
 
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
+        // Picks the type with all required properties that has the most of the preferred ones.
+        uint32_t findMemoryType(
+                uint32_t typeFilter, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferredProperties);
+
+        VkMemoryPropertyFlags getMemoryTypeProperties(uint32_t memoryTypeIndex) {
+            return memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+        }
+
         QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
 
         VkFormat findSupportedFormat(
@@ -73,12 +136,42 @@ namespace lve {
                 VkBuffer &buffer,
                 VkDeviceMemory &bufferMemory);
 
+        // Returns the property flags of the memory type that was actually picked.
+        VkMemoryPropertyFlags createBuffer(
+                VkDeviceSize size,
+                VkBufferUsageFlags usage,
+                VkMemoryPropertyFlags properties,
+                VkBuffer &buffer,
+                VkDeviceMemory &bufferMemory,
+                LveMemoryCategory category,
+                VkMemoryPropertyFlags preferredProperties = 0);
+
         VkCommandBuffer beginSingleTimeCommands();
 
         void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 
         void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 
+        // Records and submits the copy on the transfer queue without waiting for it. The destination
+        // becomes usable by the first frame whose command buffer passes through acquirePendingTransfers.
+        void copyBufferAsync(
+                VkBuffer srcBuffer,
+                VkBuffer dstBuffer,
+                VkDeviceSize size,
+                VkAccessFlags dstAccessMask,
+                VkPipelineStageFlags dstStageMask,
+                std::shared_ptr<void> keepAlive = nullptr);
+
+        // Records the queue family ownership acquires for all uploads submitted since the last call
+        // into the frame's command buffer and returns the semaphores its submission has to wait on.
+        void acquirePendingTransfers(
+                VkCommandBuffer commandBuffer,
+                std::vector<VkSemaphore> &waitSemaphores,
+                std::vector<VkPipelineStageFlags> &waitStages);
+
+        // Must be called once the frame that waited on the acquired semaphores has been submitted.
+        void releaseAcquiredTransferSemaphores();
+
         void copyBufferToImage(
                 VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -86,7 +179,38 @@ namespace lve {
                 const VkImageCreateInfo &imageInfo,
                 VkMemoryPropertyFlags properties,
                 VkImage &image,
-                VkDeviceMemory &imageMemory);
+                VkDeviceMemory &imageMemory,
+                LveMemoryCategory category = LveMemoryCategory::Texture);
+
+        // Use instead of vkFreeMemory for memory from createBuffer/createImageWithInfo so it is untracked.
+        void freeMemory(VkDeviceMemory memory);
+
+        // Memory Instrumentation
+        MemoryStats getMemoryStats();
+
+        void printMemoryStats(std::ostream &out);
+
+        void writeMemoryStatsJson(const std::string &filepath);
+
+        static const char *memoryCategoryName(LveMemoryCategory category);
+
+        static LveMemoryCategory memoryCategoryForUsage(VkBufferUsageFlags usage);
+
+        // Buffers created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR require this to be true.
+        bool supportsBufferDeviceAddress() const { return bufferDeviceAddressEnabled; }
+
+        VkDeviceAddress getBufferDeviceAddress(VkBuffer buffer);
+
+        bool supportsDrawIndirectFirstInstance() const { return drawIndirectFirstInstanceEnabled; }
+
+        // Pipeline statistics queries, e.g. for counting fragment shader invocations.
+        bool supportsPipelineStatistics() const { return pipelineStatisticsEnabled; }
+
+        // Shared by every pipeline creation; loaded from PIPELINE_CACHE_PATH and saved back there
+        // when the device is destroyed.
+        LvePipelineCache &pipelineCache() { return *pipelineCache_; }
+        // Shader modules shared by every pipeline; they stay alive until the device is destroyed.
+        LveShaderModuleCache &shaderModules() { return *shaderModules_; }
 
         VkPhysicalDeviceProperties properties;
 
@@ -103,6 +227,18 @@ namespace lve {
 
         void createCommandPool();
 
+        void createTransferCommandPool();
+
+        VkCommandBuffer beginTransferCommands();
+
+        VkSemaphore getTransferSemaphore();
+
+        void collectFinishedTransfers();
+
+        void submitTransfer(VkCommandBuffer commandBuffer, PendingTransfer &transfer);
+
+        void waitForTransfer(PendingTransfer &transfer);
+
         // helper functions
         bool isDeviceSuitable(VkPhysicalDevice device);
 
@@ -118,6 +254,11 @@ namespace lve {
 
         bool checkDeviceExtensionSupport(VkPhysicalDevice device);
 
+        bool isDeviceExtensionSupported(VkPhysicalDevice device, const char *extensionName);
+
+        VkResult allocateMemory(
+                const VkMemoryAllocateInfo &allocInfo, LveMemoryCategory category, VkDeviceMemory &memory);
+
         SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
         VkInstance instance;
@@ -125,14 +266,42 @@ namespace lve {
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
         LveWindow &window;
         VkCommandPool commandPool;
+        VkCommandPool transferCommandPool;
 
         VkDevice device_;
         VkSurfaceKHR surface_;
         VkQueue graphicsQueue_;
         VkQueue presentQueue_;
+        VkQueue transferQueue_;
+
+        bool dedicatedTransfer = false;
+        uint32_t graphicsFamilyIndex;
+        uint32_t transferFamilyIndex;
+        std::vector<PendingTransfer> pendingTransfers;    // submitted, not yet acquired by a frame
+        std::vector<PendingTransfer> acquiredTransfers;   // acquired, waiting for the copy to finish
+        std::vector<VkSemaphore> acquiredSemaphores;      // waited on by the frame being recorded
+        std::vector<VkSemaphore> freeTransferSemaphores;
+
+        struct TrackedAllocation {
+            VkDeviceSize size;
+            uint32_t heapIndex;
+            LveMemoryCategory category;
+        };
+        std::unordered_map<VkDeviceMemory, TrackedAllocation> trackedAllocations;
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        bool physicalDeviceProperties2Enabled = false;
+        bool memoryBudgetEnabled = false;
+        uint32_t instanceApiVersion = VK_API_VERSION_1_0;
+        bool bufferDeviceAddressEnabled = false;
+        bool drawIndirectFirstInstanceEnabled = false;
+        bool pipelineStatisticsEnabled = false;
+        std::unique_ptr<LvePipelineCache> pipelineCache_;
+        std::unique_ptr<LveShaderModuleCache> shaderModules_;
+        PFN_vkGetBufferDeviceAddressKHR vkGetBufferDeviceAddressKHR_ = nullptr;
 
         const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
         const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        std::vector<const char *> enabledDeviceExtensions;
     };
 
 }  // namespace lve
\ No newline at end of file
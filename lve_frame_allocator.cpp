@@ -0,0 +1,68 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+#include "lve_frame_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+    LveFrameAllocator::LveFrameAllocator(LveDevice &device, VkDeviceSize bytesPerFrame, uint32_t frameCount) {
+        const auto &limits = device.properties.limits;
+        alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        if (device.supportsBufferDeviceAddress()) {
+            usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT_KHR;
+        }
+
+        // Regions start on a nonCoherentAtomSize boundary so flushing one never touches another. One
+        // more region than frames is made: it is never allocated from, so a dynamic descriptor range
+        // of up to bytesPerFrame stays inside the buffer at any offset of the last frame.
+        buffer = std::make_unique<LveBuffer>(
+                device,
+                bytesPerFrame,
+                frameCount + 1,
+                usage,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                std::max(alignment, limits.nonCoherentAtomSize),
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        // Each frame region starts on an aligned boundary, so it may be slightly larger than asked for.
+        this->bytesPerFrame = buffer->getBufferSize() / (frameCount + 1);
+        frameEnd = this->bytesPerFrame;
+    }
+
+    void LveFrameAllocator::beginFrame(int frameIndex) {
+        frameBegin = static_cast<VkDeviceSize>(frameIndex) * bytesPerFrame;
+        frameEnd = frameBegin + bytesPerFrame;
+        head = frameBegin;
+    }
+
+    LveFrameAllocator::Allocation LveFrameAllocator::allocate(VkDeviceSize size) {
+        assert(size > 0 && "Cannot make an empty frame allocation");
+        VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+        if (offset + size > frameEnd) {
+            throw std::runtime_error("frame allocator out of memory!");
+        }
+        head = offset + size;
+        buffer->addFlushRange(size, offset);
+
+        Allocation allocation{};
+        allocation.data = static_cast<char *>(buffer->getMappedMemory()) + offset;
+        allocation.offset = static_cast<uint32_t>(offset);
+        allocation.size = size;
+        if (buffer->getDeviceAddress() != 0) {
+            allocation.deviceAddress = buffer->getDeviceAddress() + offset;
+        }
+        return allocation;
+    }
+
+    void LveFrameAllocator::flush() {
+        buffer->flushPending();
+    }
+}
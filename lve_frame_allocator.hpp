@@ -0,0 +1,84 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_FRAME_ALLOCATOR_HPP
+#define VULKANTEST_LVE_FRAME_ALLOCATOR_HPP
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <cassert>
+#include <cstring>
+#include <memory>
+
+namespace lve {
+
+    // Bump allocator over one large persistently mapped buffer, split into one region per frame in
+    // flight. Sub-allocations are aligned for use as dynamic uniform or storage buffer offsets (or
+    // as indirect draw commands) and are only valid until the same frame index comes around again. The buffer prefers device local
+    // host visible memory (ReBAR) so the GPU reads it at full speed. It ends in a spare region of
+    // bytesPerFrame, so a dynamic descriptor with a range of bytesPerFrame covers any allocation.
+    class LveFrameAllocator {
+    public:
+        struct Allocation {
+            void *data = nullptr;   // host pointer to write the data to
+            uint32_t offset = 0;    // dynamic offset to pass to vkCmdBindDescriptorSets
+            VkDeviceSize size = 0;
+            VkDeviceAddress deviceAddress = 0;  // for shaders, when the device supports buffer device address
+        };
+
+        LveFrameAllocator(
+                LveDevice &device,
+                VkDeviceSize bytesPerFrame,
+                uint32_t frameCount = LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+
+        LveFrameAllocator(const LveFrameAllocator&) = delete;
+        LveFrameAllocator &operator=(const LveFrameAllocator&) = delete;
+
+        // Must only be called once the fence of the frame that last used frameIndex has signaled,
+        // i.e. after LveRenderer::beginFrame.
+        void beginFrame(int frameIndex);
+
+        Allocation allocate(VkDeviceSize size);
+
+        // Makes this frame's allocations visible to the device; a no-op on coherent memory. Each
+        // allocation queued its own range, so only what was allocated is flushed, with ranges that
+        // touch after nonCoherentAtomSize rounding merged into one vkFlushMappedMemoryRanges call.
+        void flush();
+
+        template<typename T>
+        Allocation push(const T &value) {
+            Allocation allocation = allocate(sizeof(T));
+            memcpy(allocation.data, &value, sizeof(T));
+            return allocation;
+        }
+
+        // Binding info for a *_DYNAMIC descriptor; the real start is supplied as the dynamic offset.
+        // Dynamic offset + range must stay inside the buffer, so VK_WHOLE_SIZE is not allowed: the
+        // range must be at most bytesPerFrame, and each allocation bound through the descriptor at
+        // most range bytes.
+        VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) {
+            assert(range != VK_WHOLE_SIZE && range <= bytesPerFrame && "Dynamic descriptor range must fit a frame");
+            return buffer->descriptorInfo(range, 0);
+        }
+
+        VkBuffer getBuffer() const { return buffer->getBuffer(); }
+        VkDeviceSize getAlignment() const { return alignment; }
+        VkDeviceSize getBytesPerFrame() const { return bytesPerFrame; }
+        VkDeviceSize getUsedBytes() const { return head - frameBegin; }
+        VkDeviceAddress getDeviceAddress() const { return buffer->getDeviceAddress(); }
+
+    private:
+        std::unique_ptr<LveBuffer> buffer;
+        VkDeviceSize bytesPerFrame;
+        VkDeviceSize alignment;
+        VkDeviceSize frameBegin = 0;
+        VkDeviceSize frameEnd = 0;
+        VkDeviceSize head = 0;
+    };
+}
+
+#endif //VULKANTEST_LVE_FRAME_ALLOCATOR_HPP
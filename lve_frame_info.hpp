@@ -5,18 +5,28 @@
 #ifndef VULKANTEST_LVE_FRAME_INFO_HPP
 #define VULKANTEST_LVE_FRAME_INFO_HPP
 
+#include "lve_bvh.hpp"
 #include "lve_camera.hpp"
+#include "lve_frame_allocator.hpp"
 #include "lve_game_object.hpp"
+#include "lve_occlusion_rasterizer.hpp"
+#include "lve_sparse_set.hpp"
 
 #include <vulkan/vulkan.h>
 
 namespace lve {
 
-    #define MAX_LIGHTS 10
+    // Per object light lists hold indices into the light buffer, most significant light first.
+    // NO_LIGHT ends a shorter list, and a list starting with CLUSTERED_LIGHTS makes the shader
+    // take the lights from the fragment's light cluster instead.
+    constexpr uint32_t MAX_OBJECT_LIGHTS = 4;
+    constexpr uint32_t NO_LIGHT = 0xffffffffu;
+    constexpr uint32_t CLUSTERED_LIGHTS = 0xfffffffeu;
 
+    // An entry of the light storage buffer; there is no limit on the number of lights.
     struct PointLight {
-        glm::vec4 position{};
-        glm::vec4 color{};
+        glm::vec4 position{};  // w is the range, past which the light has no effect
+        glm::vec4 color{};     // w is intensity
     };
 
     struct GlobalUbo {
@@ -24,8 +34,10 @@ namespace lve {
         glm::mat4 view{1.f};
         glm::mat4 inverseView{1.f}; //camera info
         glm::vec4 ambientLightColor{1.0f, 1.0f, 1.0f, 0.02f};
-        PointLight pointLights[MAX_LIGHTS];
-        int numLights;
+        // Light cluster grid of LveLightClusters: tiles in x and y, depth slices, number of lights.
+        glm::uvec4 clusterCounts{0};
+        // Pixels per tile in x and y, then the scale and bias from log(view depth) to a slice.
+        glm::vec4 clusterParams{0.f};
     };
 
     struct FrameInfo {
@@ -35,6 +47,21 @@ namespace lve {
         LveCamera &camera;
         VkDescriptorSet globalDescriptorSet;
         LveGameObject::Map &gameObjects;
+        LveFrameAllocator &frameAllocator;  // per-frame uniform/storage data, bound with dynamic offsets
+        uint32_t globalUboOffset = 0;       // dynamic offset of this frame's GlobalUbo
+        uint32_t instanceDataOffset = 0;    // dynamic offset of SimpleRenderSystem's instance buffer
+        uint32_t lightDataOffset = 0;       // dynamic offsets of PointLightSystem's light buffer
+        uint32_t lightClusterOffset = 0;    // and of its light cluster lists
+        uint32_t lightBillboardOffset = 0;  // and of the billboards it draws for them
+        VkExtent2D extent{};                // of the framebuffer drawn to, for the light cluster tiles
+        const LveBvh *sceneBvh = nullptr;   // world bounds of the objects with a model, keyed by id
+        // This frame's occluders, already rasterized; objects it hides are not drawn on the CPU path.
+        LveOcclusionRasterizer *occlusionRasterizer = nullptr;
+        // Light list per object id, when PointLightSystem builds them; otherwise lights are clustered.
+        const LveSparseSet<glm::uvec4> *objectLights = nullptr;
+        // Objects whose world matrix changed since the last frame, from LveSceneHierarchy::update;
+        // without it every object counts as changed.
+        const std::vector<LveGameObject::id_t> *changedTransforms = nullptr;
     };
 }
 
@@ -0,0 +1,97 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+#include "lve_frustum_culler.hpp"
+
+#if defined(__AVX__)
+#define LVE_CULL_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_CULL_SSE
+#include <emmintrin.h>
+#endif
+
+namespace lve {
+
+    void LveFrustumCuller::clear() {
+        centerX.clear();
+        centerY.clear();
+        centerZ.clear();
+        radius.clear();
+    }
+
+    void LveFrustumCuller::addSphere(const glm::vec3 &center, float sphereRadius) {
+        centerX.push_back(center.x);
+        centerY.push_back(center.y);
+        centerZ.push_back(center.z);
+        radius.push_back(sphereRadius);
+    }
+
+    void LveFrustumCuller::cull(const std::array<glm::vec4, 6> &planes, std::vector<uint32_t> &visible) const {
+        size_t count = size();
+        size_t i = 0;
+
+#if defined(LVE_CULL_AVX)
+        for (; i + 8 <= count; i += 8) {
+            __m256 x = _mm256_loadu_ps(&centerX[i]);
+            __m256 y = _mm256_loadu_ps(&centerY[i]);
+            __m256 z = _mm256_loadu_ps(&centerZ[i]);
+            __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&radius[i]));
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const auto &plane : planes) {
+                __m256 distance = _mm256_add_ps(
+                        _mm256_add_ps(
+                                _mm256_mul_ps(x, _mm256_set1_ps(plane.x)),
+                                _mm256_mul_ps(y, _mm256_set1_ps(plane.y))),
+                        _mm256_add_ps(
+                                _mm256_mul_ps(z, _mm256_set1_ps(plane.z)),
+                                _mm256_set1_ps(plane.w)));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+            }
+
+            int mask = _mm256_movemask_ps(inside);
+            for (uint32_t lane = 0; mask != 0; lane++, mask >>= 1) {
+                if (mask & 1) visible.push_back(static_cast<uint32_t>(i) + lane);
+            }
+        }
+#elif defined(LVE_CULL_SSE)
+        for (; i + 4 <= count; i += 4) {
+            __m128 x = _mm_loadu_ps(&centerX[i]);
+            __m128 y = _mm_loadu_ps(&centerY[i]);
+            __m128 z = _mm_loadu_ps(&centerZ[i]);
+            __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radius[i]));
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const auto &plane : planes) {
+                __m128 distance = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                        _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+            }
+
+            int mask = _mm_movemask_ps(inside);
+            for (uint32_t lane = 0; mask != 0; lane++, mask >>= 1) {
+                if (mask & 1) visible.push_back(static_cast<uint32_t>(i) + lane);
+            }
+        }
+#endif
+
+        cullScalar(planes, i, visible);
+    }
+
+    void LveFrustumCuller::cullScalar(
+            const std::array<glm::vec4, 6> &planes, size_t begin, std::vector<uint32_t> &visible) const {
+        for (size_t i = begin; i < size(); i++) {
+            bool inside = true;
+            for (const auto &plane : planes) {
+                float distance = centerX[i] * plane.x + centerY[i] * plane.y + centerZ[i] * plane.z + plane.w;
+                if (distance < -radius[i]) {
+                    inside = false;
+                    break;
+                }
+            }
+            if (inside) visible.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
@@ -0,0 +1,44 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_FRUSTUM_CULLER_HPP
+#define VULKANTEST_LVE_FRUSTUM_CULLER_HPP
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+    // Tests world space bounding spheres against the six frustum planes from
+    // LveCamera::getFrustumPlanes. The spheres are kept as structure of arrays so every plane test
+    // is a handful of vector multiply-adds over contiguous floats: 8 spheres at a time with AVX, 4
+    // with SSE, and a scalar loop for the remainder or other targets.
+    class LveFrustumCuller {
+    public:
+        void clear();
+        void addSphere(const glm::vec3 &center, float radius);
+
+        // Appends the indices, in add order, of the spheres that are at least partly inside.
+        void cull(const std::array<glm::vec4, 6> &planes, std::vector<uint32_t> &visible) const;
+
+        size_t size() const { return radius.size(); }
+
+    private:
+        void cullScalar(const std::array<glm::vec4, 6> &planes, size_t begin, std::vector<uint32_t> &visible) const;
+
+        std::vector<float> centerX;
+        std::vector<float> centerY;
+        std::vector<float> centerZ;
+        std::vector<float> radius;
+    };
+}
+
+#endif //VULKANTEST_LVE_FRUSTUM_CULLER_HPP
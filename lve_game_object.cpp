@@ -6,65 +6,114 @@
 
 namespace lve {
 
-    glm::mat4 TransformComponent::mat4() const {
-        const float c3 = glm::cos(rotation.z);
-        const float s3 = glm::sin(rotation.z);
-        const float c2 = glm::cos(rotation.y);
-        const float s2 = glm::sin(rotation.y);
-        const float c1 = glm::cos(rotation.x);
-        const float s1 = glm::sin(rotation.x);
-        return glm::mat4{
-                {
-                        scale.x * (c1 * c3 + s1 * s2 * s3),
-                        scale.x * (c2 * s3),
-                        scale.x * (c1 * s2 * s3 - c3 * s1),
-                        0.0f},
-                {
-                        scale.y * (c3 * s1 * s2 - c1 * s3),
-                        scale.y * (c2 * c3),
-                        scale.y * (c1 * c3 * s2 + s1 * s3),
-                        0.0f},
-                {
-                        scale.z * (c2 * s1),
-                        scale.z * (-s2),
-                        scale.z * (c1 * c2),
-                        0.0f},
-                {translation.x, translation.y, translation.z, 1.0f}};
-    }
+    void TransformComponent::refresh() const {
+        if (!isStale()) {
+            return;
+        }
+        version++;
+        cachedTranslation = translation;
+        cachedMatrix[3] = {translation.x, translation.y, translation.z, 1.0f};
+        if (rotation == cachedRotation && scale == cachedScale) {
+            return;
+        }
+        cachedRotation = rotation;
+        cachedScale = scale;
 
-    glm::mat4 TransformComponent::normalMatrix(){
         const float c3 = glm::cos(rotation.z);
         const float s3 = glm::sin(rotation.z);
         const float c2 = glm::cos(rotation.y);
         const float s2 = glm::sin(rotation.y);
         const float c1 = glm::cos(rotation.x);
         const float s1 = glm::sin(rotation.x);
+        const glm::vec3 rotationColumns[3] = {
+                {(c1 * c3 + s1 * s2 * s3), (c2 * s3), (c1 * s2 * s3 - c3 * s1)},
+                {(c3 * s1 * s2 - c1 * s3), (c2 * c3), (c1 * c3 * s2 + s1 * s3)},
+                {(c2 * s1), (-s2), (c1 * c2)}};
         const glm::vec3 invScale = 1.0f / scale;
-        return glm::mat4{
-                {
-                        invScale.x * (c1 * c3 + s1 * s2 * s3),
-                        invScale.x * (c2 * s3),
-                        invScale.x * (c1 * s2 * s3 - c3 * s1),
-                        0.0f},
-                {
-                        invScale.y * (c3 * s1 * s2 - c1 * s3),
-                        invScale.y * (c2 * c3),
-                        invScale.y * (c1 * c3 * s2 + s1 * s3),
-                        0.0f},
-                {
-                        invScale.z * (c2 * s1),
-                        invScale.z * (-s2),
-                        invScale.z * (c1 * c2),
-                        0.0f},
-                {0.0f, 0.0f, 0.0f, 1.0f}};
+        for (int i = 0; i < 3; i++) {
+            cachedMatrix[i] = glm::vec4(scale[i] * rotationColumns[i], 0.0f);
+            cachedNormalMatrix[i] = glm::vec4(invScale[i] * rotationColumns[i], 0.0f);
+        }
+    }
+
+    void TransformComponent::store(const glm::mat4 &model, const glm::mat4 &normal) const {
+        version++;
+        cachedTranslation = translation;
+        cachedRotation = rotation;
+        cachedScale = scale;
+        cachedMatrix = model;
+        cachedNormalMatrix = normal;
+    }
+
+    const glm::mat4 &TransformComponent::mat4() const {
+        refresh();
+        return cachedMatrix;
+    }
+
+    const glm::mat4 &TransformComponent::normalMatrix() const {
+        refresh();
+        return cachedNormalMatrix;
+    }
+
+    uint32_t TransformComponent::getVersion() const {
+        refresh();
+        return version;
+    }
+
+    glm::vec4 LveGameObject::getWorldBoundingSphere() const {
+        const glm::vec4 &sphere = model->getBoundingSphere();
+        glm::vec3 center{worldMatrix * glm::vec4{glm::vec3{sphere}, 1.f}};
+        float maxScale = glm::max(
+                glm::length(glm::vec3{worldMatrix[0]}),
+                glm::max(glm::length(glm::vec3{worldMatrix[1]}), glm::length(glm::vec3{worldMatrix[2]})));
+        return {center, sphere.w * maxScale};
+    }
+
+    LveGameObject &LveGameObjectMap::emplace(id_t id, LveGameObject &&gameObject) {
+        LveGameObject &inserted = objects.emplace(id, std::move(gameObject));
+        LveGameObject::structureVersion++;
+        updateComponents(id);
+        return inserted;
+    }
+
+    void LveGameObjectMap::erase(id_t id) {
+        if (!objects.contains(id)) {
+            return;
+        }
+        LveGameObject::structureVersion++;
+        objects.erase(id);
+        updateComponents(id);
+    }
+
+    void LveGameObjectMap::updateComponents(id_t id) {
+        // A swapped model moves the object to another draw group even if no set changes.
+        LveGameObject::structureVersion++;
+        const LveGameObject *gameObject = objects.find(id);
+        bool hasModel = gameObject != nullptr && gameObject->model != nullptr;
+        bool hasPointLight = gameObject != nullptr && gameObject->pointLight.has_value();
+        bool hasOccluder = gameObject != nullptr && gameObject->occluder != nullptr;
+        if (hasModel && !models.contains(id)) {
+            models.emplace(id, Member{});
+        } else if (!hasModel && models.contains(id)) {
+            models.erase(id);
         }
+        if (hasPointLight && !pointLights.contains(id)) {
+            pointLights.emplace(id, Member{});
+        } else if (!hasPointLight && pointLights.contains(id)) {
+            pointLights.erase(id);
+        }
+        if (hasOccluder && !occluders.contains(id)) {
+            occluders.emplace(id, Member{});
+        } else if (!hasOccluder && occluders.contains(id)) {
+            occluders.erase(id);
+        }
+    }
 
     LveGameObject LveGameObject::makePointLight(float intensity, float radius, glm::vec3 color) {
         LveGameObject gameObj = LveGameObject::createGameObject();
         gameObj.color = color;
         gameObj.transform.scale.x = radius;
-        gameObj.pointLight = std::make_unique<PointLightComponent>();
-        gameObj.pointLight->lightIntensity = intensity;
+        gameObj.pointLight = PointLightComponent{intensity};
         return gameObj;
     }
 
@@ -6,9 +6,13 @@
 #define VULKANTEST_LVE_GAME_OBJECT_HPP
 
 #include "lve_model.hpp"
+#include "lve_occluder.hpp"
+#include "lve_sparse_set.hpp"
 #include <glm/gtc/matrix_transform.hpp>
+#include <limits>
 #include <memory>
-#include <unordered_map>
+#include <optional>
+#include <vector>
 
 namespace lve {
 
@@ -25,6 +29,9 @@ namespace lve {
         float duration;
     };
 
+    class LveSceneHierarchy;
+    class LveGameObjectMap;
+
     struct TransformComponent {
         glm::vec3 translation{};
         glm::vec3 scale{1.0f, 1.0f, 1.0f};
@@ -36,41 +43,59 @@ namespace lve {
 
         // Need to go over base form of each in class.
         // Need to show standard rotation matrix found in most books.
-        glm::mat4 mat4() const;
-        glm::mat4 normalMatrix();
+        // Both matrices are cached and only rebuilt once translation, rotation or scale differ from
+        // the values they were built from; a translation alone skips the trig. getVersion() goes
+        // up by one on every rebuild.
+        const glm::mat4 &mat4() const;
+        const glm::mat4 &normalMatrix() const;
+        uint32_t getVersion() const;
         bool update(float deltaTime);  // New method to update based on animations
+
+    private:
+        friend class LveSceneHierarchy;
+
+        bool isStale() const {
+            return translation != cachedTranslation || rotation != cachedRotation || scale != cachedScale;
+        }
+        void refresh() const;
+        void store(const glm::mat4 &model, const glm::mat4 &normal) const;
+
+        mutable glm::vec3 cachedTranslation{};
+        mutable glm::vec3 cachedScale{1.0f, 1.0f, 1.0f};
+        mutable glm::vec3 cachedRotation{0.0f};
+        mutable glm::mat4 cachedMatrix{1.0f};
+        mutable glm::mat4 cachedNormalMatrix{1.0f};
+        mutable uint32_t version = 0;
     };
 
     struct PointLightComponent {
         float lightIntensity = 1.0f;
     };
 
-    class LveGameObject : public std::enable_shared_from_this<LveGameObject>{
+    class LveGameObject {
     public:
-        using id_t = unsigned int;
-        using Map = std::unordered_map<id_t, LveGameObject>;
+        using id_t = uint32_t;
+        using Map = LveGameObjectMap;
+        static constexpr id_t NO_PARENT = std::numeric_limits<id_t>::max();
 
         static LveGameObject createGameObject() {
             static id_t currentId = 0;
             return LveGameObject{currentId++};
         }
 
-        std::shared_ptr<LveGameObject> parent;  // Pointer to the parent object
-        std::vector<std::shared_ptr<LveGameObject>> children;  // List of child objects
-
-        // Method to get the world transformation
-        glm::mat4 getWorldTransform() const {
-            glm::mat4 parentTransform = parent ? parent->getWorldTransform() : glm::mat4(1.0f);
-            return parentTransform * transform.mat4();
-        }
+        // World transformation, as of the last LveSceneHierarchy::update.
+        const glm::mat4 &getWorldTransform() const { return worldMatrix; }
+        // The model's bounding sphere in world space (xyz center, w radius); needs a model.
+        glm::vec4 getWorldBoundingSphere() const;
 
-        // Method to set the parent
-        void setParent(std::shared_ptr<LveGameObject> newParent) {
-            parent = newParent;
-            if (newParent) {
-                newParent->children.push_back(shared_from_this());
-            }
+        // Parents are referred to by id, since the objects live by value in a Map. A parent that
+        // is not in the map makes the object a root.
+        void setParent(id_t newParentId) {
+            parentId = newParentId;
+            structureVersion++;
         }
+        id_t getParentId() const { return parentId; }
+        bool hasParent() const { return parentId != NO_PARENT; }
 
         static LveGameObject makePointLight(float intensity = 10.0f, float radius = 0.1f, glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f));
 
@@ -88,11 +113,64 @@ namespace lve {
 
         // Optional components
         std::shared_ptr<LveModel> model{};
-        std::unique_ptr<PointLightComponent> pointLight = nullptr;
+        std::optional<PointLightComponent> pointLight{};  // inline, so reading it doesn't chase a pointer
+        std::shared_ptr<LveOccluder> occluder{};  // drawn by LveOcclusionRasterizer to hide what is behind
 
     private:
         LveGameObject(id_t id) : id(id) {}
         id_t id;
+
+        friend class LveSceneHierarchy;
+        friend class LveGameObjectMap;
+        // Goes up whenever an object is added, removed, reparented or has its components updated,
+        // so the hierarchy knows to re-sort and the renderer to regroup.
+        inline static uint32_t structureVersion = 0;
+
+        id_t parentId = NO_PARENT;
+        glm::mat4 worldMatrix{1.0f};
+    };
+
+    // The scene's game objects, packed densely and looked up by their stable id, plus one sparse
+    // set per component that systems query, so e.g. the light system visits the handful of
+    // lights without scanning every object. Those sets hold ids only: the component data stays
+    // on LveGameObject and is reached through at(id), so walking a set is contiguous in its ids
+    // but not in the components, which sit wherever their objects are in the dense object array.
+    // Only iterating the whole map is a linear walk over memory. Components are registered when
+    // the object is emplaced; call updateComponents after giving an object already in the map a
+    // model, point light or occluder, swapping one or taking one away.
+    class LveGameObjectMap {
+    public:
+        using id_t = LveGameObject::id_t;
+
+        LveGameObject &emplace(id_t id, LveGameObject &&gameObject);
+        void erase(id_t id);
+        void updateComponents(id_t id);
+
+        LveGameObject &at(id_t id) { return objects.at(id); }
+        const LveGameObject &at(id_t id) const { return objects.at(id); }
+        LveGameObject *find(id_t id) { return objects.find(id); }
+        bool contains(id_t id) const { return objects.contains(id); }
+        size_t size() const { return objects.size(); }
+        // Changes whenever objects are added, removed or reparented, or their components updated.
+        uint32_t getStructureVersion() const { return LveGameObject::structureVersion; }
+
+        // Every object, in dense order.
+        auto begin() { return objects.begin(); }
+        auto end() { return objects.end(); }
+        auto begin() const { return objects.begin(); }
+        auto end() const { return objects.end(); }
+
+        const std::vector<id_t> &withModel() const { return models.ids(); }
+        const std::vector<id_t> &withPointLight() const { return pointLights.ids(); }
+        const std::vector<id_t> &withOccluder() const { return occluders.ids(); }
+
+    private:
+        struct Member {};
+
+        LveSparseSet<LveGameObject> objects;
+        LveSparseSet<Member> models;
+        LveSparseSet<Member> pointLights;
+        LveSparseSet<Member> occluders;
     };
 }
 
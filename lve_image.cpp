@@ -29,7 +29,7 @@ namespace lve {
         vkDestroySampler(lveDevice.device(), textureSampler, nullptr);
         vkDestroyImageView(lveDevice.device(), imageView, nullptr);
         vkDestroyImage(lveDevice.device(), image, nullptr);
-        vkFreeMemory(lveDevice.device(), imageMemory, nullptr);
+        lveDevice.freeMemory(imageMemory);
     }
 
     VkDescriptorImageInfo LveImage::descriptorImageInfo() {
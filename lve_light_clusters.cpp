@@ -0,0 +1,147 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#include "lve_light_clusters.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+namespace lve {
+
+    namespace {
+        // Tile containing an NDC coordinate, clamped to the screen.
+        uint32_t tileOf(float ndc, uint32_t tileCount) {
+            float tile = std::max((ndc + 1.f) * 0.5f * static_cast<float>(tileCount), 0.f);
+            return std::min(static_cast<uint32_t>(tile), tileCount - 1);
+        }
+    }
+
+    void LveLightClusters::updateBounds(const glm::mat4 &projection) {
+        assert(projection[2][3] == 1.f && "Light clusters need a perspective projection");
+
+        glm::vec4 entries{projection[0][0], projection[1][1], projection[2][2], projection[3][2]};
+        if (entries == boundsProjection && !bounds.empty()) {
+            return;
+        }
+        boundsProjection = entries;
+
+        // Inverts the depth terms of LveCamera::setPerspectiveProjection.
+        near = -projection[3][2] / projection[2][2];
+        far = projection[3][2] / (1.f - projection[2][2]);
+        const float logDepthRange = std::log(far / near);
+        sliceScale = static_cast<float>(SLICES) / logDepthRange;
+        sliceBias = -static_cast<float>(SLICES) * std::log(near) / logDepthRange;
+
+        // A cluster's x and y extent grows with depth, so its box is spanned by the tile's
+        // corners on the near and far face of the slice.
+        bounds.resize(CLUSTER_COUNT);
+        const float tileWidth = 2.f / static_cast<float>(TILES_X);
+        const float tileHeight = 2.f / static_cast<float>(TILES_Y);
+        for (uint32_t z = 0; z < SLICES; z++) {
+            float nearDepth = near * std::pow(far / near, static_cast<float>(z) / SLICES);
+            float farDepth = near * std::pow(far / near, static_cast<float>(z + 1) / SLICES);
+            for (uint32_t y = 0; y < TILES_Y; y++) {
+                float top = -1.f + tileHeight * static_cast<float>(y);
+                float bottom = top + tileHeight;
+                for (uint32_t x = 0; x < TILES_X; x++) {
+                    float left = -1.f + tileWidth * static_cast<float>(x);
+                    float right = left + tileWidth;
+
+                    Bounds &box = bounds[(z * TILES_Y + y) * TILES_X + x];
+                    box.min.x = std::min(left * nearDepth, left * farDepth) / projection[0][0];
+                    box.max.x = std::max(right * nearDepth, right * farDepth) / projection[0][0];
+                    box.min.y = std::min(top * nearDepth, top * farDepth) / projection[1][1];
+                    box.max.y = std::max(bottom * nearDepth, bottom * farDepth) / projection[1][1];
+                    box.min.z = nearDepth;
+                    box.max.z = farDepth;
+                }
+            }
+        }
+    }
+
+    uint32_t LveLightClusters::slice(float depth) const {
+        float index = std::floor(std::log(depth) * sliceScale + sliceBias);
+        return static_cast<uint32_t>(std::clamp(index, 0.f, static_cast<float>(SLICES - 1)));
+    }
+
+    void LveLightClusters::build(const glm::mat4 &projection, const std::vector<glm::vec4> &viewSpaceLights) {
+        auto start = std::chrono::high_resolution_clock::now();
+        updateBounds(projection);
+        stats = {};
+        referenceClusters.clear();
+        referenceLights.clear();
+
+        const float p00 = projection[0][0];
+        const float p11 = projection[1][1];
+        for (uint32_t lightIndex = 0; lightIndex < viewSpaceLights.size(); lightIndex++) {
+            const glm::vec3 center{viewSpaceLights[lightIndex]};
+            const float range = viewSpaceLights[lightIndex].w;
+            float minDepth = std::max(center.z - range, near);
+            float maxDepth = std::min(center.z + range, far);
+            if (minDepth > maxDepth) {
+                continue;
+            }
+
+            // Screen rectangle of the light's bounding box cut to [minDepth, maxDepth]; for a
+            // fixed x (or y), x / z is monotonic in z, so the extremes are on the two depths.
+            float left = p00 * std::min((center.x - range) / minDepth, (center.x - range) / maxDepth);
+            float right = p00 * std::max((center.x + range) / minDepth, (center.x + range) / maxDepth);
+            float top = p11 * std::min((center.y - range) / minDepth, (center.y - range) / maxDepth);
+            float bottom = p11 * std::max((center.y + range) / minDepth, (center.y + range) / maxDepth);
+            if (right < -1.f || left > 1.f || bottom < -1.f || top > 1.f) {
+                continue;
+            }
+
+            const uint32_t firstX = tileOf(left, TILES_X), lastX = tileOf(right, TILES_X);
+            const uint32_t firstY = tileOf(top, TILES_Y), lastY = tileOf(bottom, TILES_Y);
+            const uint32_t firstZ = slice(minDepth), lastZ = slice(maxDepth);
+            const float rangeSquared = range * range;
+            bool binned = false;
+            for (uint32_t z = firstZ; z <= lastZ; z++) {
+                for (uint32_t y = firstY; y <= lastY; y++) {
+                    for (uint32_t x = firstX; x <= lastX; x++) {
+                        uint32_t cluster = (z * TILES_Y + y) * TILES_X + x;
+                        glm::vec3 offset = glm::clamp(center, bounds[cluster].min, bounds[cluster].max) - center;
+                        if (glm::dot(offset, offset) <= rangeSquared) {
+                            referenceClusters.push_back(cluster);
+                            referenceLights.push_back(lightIndex);
+                            binned = true;
+                        }
+                    }
+                }
+            }
+            if (binned) {
+                stats.lights++;
+            }
+        }
+
+        // Counting sort of the references by cluster. Each range start first points one past its
+        // end and is walked back while filling in reverse, which keeps the lights in order.
+        const auto referenceCount = static_cast<uint32_t>(referenceLights.size());
+        data.assign(2 * CLUSTER_COUNT + referenceCount, 0);
+        for (uint32_t cluster : referenceClusters) {
+            data[2 * cluster + 1]++;
+        }
+        uint32_t end = 2 * CLUSTER_COUNT;
+        for (uint32_t cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+            end += data[2 * cluster + 1];
+            data[2 * cluster] = end;
+            stats.maxClusterLights = std::max(stats.maxClusterLights, data[2 * cluster + 1]);
+        }
+        for (uint32_t i = referenceCount; i-- > 0;) {
+            data[--data[2 * referenceClusters[i]]] = referenceLights[i];
+        }
+
+        stats.lightReferences = referenceCount;
+        stats.buildMilliseconds = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    glm::vec4 LveLightClusters::getParams(float width, float height) const {
+        return {width / static_cast<float>(TILES_X), height / static_cast<float>(TILES_Y), sliceScale, sliceBias};
+    }
+}
@@ -0,0 +1,73 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_LIGHT_CLUSTERS_HPP
+#define VULKANTEST_LVE_LIGHT_CLUSTERS_HPP
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+    // Bins point lights into the froxels of a perspective view for clustered forward shading. The
+    // screen is split into TILES_X x TILES_Y tiles and the view depth between the near and far
+    // plane into SLICES exponentially spaced slices, so clusters stay roughly cubic. A light lands
+    // in every cluster its sphere of influence touches, and simple_shader.frag only loops over the
+    // lights of the cluster its fragment is in.
+    class LveLightClusters {
+    public:
+        static constexpr uint32_t TILES_X = 16;
+        static constexpr uint32_t TILES_Y = 9;
+        static constexpr uint32_t SLICES = 24;
+        static constexpr uint32_t CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+
+        struct Stats {
+            uint32_t lights = 0;            // lights binned into at least one cluster
+            uint32_t lightReferences = 0;   // sum of the per cluster light counts
+            uint32_t maxClusterLights = 0;
+            double buildMilliseconds = 0.0;
+        };
+
+        // Bins view space light spheres (xyz center, w range) for a projection made by
+        // LveCamera::setPerspectiveProjection. Indices in the cluster data refer to this vector.
+        void build(const glm::mat4 &projection, const std::vector<glm::vec4> &viewSpaceLights);
+
+        // What simple_shader.frag reads: an (index of the first light index, light count) pair per
+        // cluster, followed by the light indices of all clusters.
+        const std::vector<uint32_t> &getData() const { return data; }
+        // Pixels per tile for a framebuffer of the given size, then the scale and bias that turn
+        // log(view depth) into a slice index.
+        glm::vec4 getParams(float width, float height) const;
+        const Stats &getStats() const { return stats; }
+
+    private:
+        struct Bounds {
+            glm::vec3 min;
+            glm::vec3 max;
+        };
+
+        void updateBounds(const glm::mat4 &projection);
+        uint32_t slice(float depth) const;
+
+        // The projection entries the cluster bounds were computed for.
+        glm::vec4 boundsProjection{0.f};
+        float near = 0.f;
+        float far = 0.f;
+        float sliceScale = 0.f;
+        float sliceBias = 0.f;
+        std::vector<Bounds> bounds;  // view space box of each cluster
+
+        std::vector<uint32_t> referenceClusters;  // (cluster, light) pairs in light order
+        std::vector<uint32_t> referenceLights;
+        std::vector<uint32_t> data;
+        Stats stats;
+    };
+}
+
+#endif //VULKANTEST_LVE_LIGHT_CLUSTERS_HPP
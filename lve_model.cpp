@@ -28,6 +28,7 @@ namespace lve {
     LveModel::LveModel(LveDevice &device, const LveModel::Builder &builder) : lveDevice(device) {
         createVertexBuffers(builder.vertices);
         createIndexBuffers(builder.indices);
+        computeBounds(builder.vertices);
     }
 
     LveModel::~LveModel() { }
@@ -44,16 +45,17 @@ namespace lve {
         VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
         uint32_t vertexSize = sizeof(vertices[0]);
 
-        LveBuffer stagingBuffer{
+        // Kept alive by the device until the transfer queue has finished copying from it.
+        auto stagingBuffer = std::make_shared<LveBuffer>(
             lveDevice,
             vertexSize,
             vertexCount,
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void *)vertices.data());
+        stagingBuffer->map();
+        stagingBuffer->writeToBuffer((void *)vertices.data());
 
         vertexBuffer = std::make_unique<LveBuffer>(
             lveDevice,
@@ -64,7 +66,13 @@ namespace lve {
         );
 
 
-        lveDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+        lveDevice.copyBufferAsync(
+            stagingBuffer->getBuffer(),
+            vertexBuffer->getBuffer(),
+            bufferSize,
+            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            stagingBuffer);
     }
 
     void LveModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
@@ -75,16 +83,16 @@ namespace lve {
         VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
         uint32_t indexSize = sizeof(indices[0]);
 
-        LveBuffer stagingBuffer{
+        auto stagingBuffer = std::make_shared<LveBuffer>(
             lveDevice,
             indexSize,
             indexCount,
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void *)indices.data());
+        stagingBuffer->map();
+        stagingBuffer->writeToBuffer((void *)indices.data());
 
         indexBuffer = std::make_unique<LveBuffer>(
             lveDevice,
@@ -93,7 +101,13 @@ namespace lve {
             VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-        lveDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+        lveDevice.copyBufferAsync(
+            stagingBuffer->getBuffer(),
+            indexBuffer->getBuffer(),
+            bufferSize,
+            VK_ACCESS_INDEX_READ_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            stagingBuffer);
     }
 
     void LveModel::bind(VkCommandBuffer commandBuffer) {
@@ -104,11 +118,47 @@ namespace lve {
             vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
     }
 
-    void LveModel::draw(VkCommandBuffer commandBuffer) {
+    void LveModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance) {
         if (hasIndexBuffer)
-            vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+            vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, firstInstance);
         else
-            vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+            vkCmdDraw(commandBuffer, vertexCount, instanceCount, 0, firstInstance);
+    }
+
+    void LveModel::writeIndirectCommand(void *command, uint32_t instanceCount, uint32_t firstInstance) const {
+        if (hasIndexBuffer) {
+            VkDrawIndexedIndirectCommand indexed{indexCount, instanceCount, 0, 0, firstInstance};
+            memcpy(command, &indexed, sizeof(indexed));
+        } else {
+            VkDrawIndirectCommand nonIndexed{vertexCount, instanceCount, 0, firstInstance};
+            memcpy(command, &nonIndexed, sizeof(nonIndexed));
+        }
+    }
+
+    void LveModel::drawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset) {
+        if (hasIndexBuffer)
+            vkCmdDrawIndexedIndirect(commandBuffer, buffer, offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+        else
+            vkCmdDrawIndirect(commandBuffer, buffer, offset, 1, sizeof(VkDrawIndirectCommand));
+    }
+
+    void LveModel::computeBounds(const std::vector<Vertex> &vertices) {
+        boundingBoxMin = vertices[0].position;
+        boundingBoxMax = vertices[0].position;
+        for (const auto &vertex : vertices) {
+            boundingBoxMin = glm::min(boundingBoxMin, vertex.position);
+            boundingBoxMax = glm::max(boundingBoxMax, vertex.position);
+        }
+
+        // The sphere is centered on the box; not minimal, but cheap and never too small.
+        glm::vec3 center = (boundingBoxMin + boundingBoxMax) * 0.5f;
+
+        float radiusSquared = 0.f;
+        for (const auto &vertex : vertices) {
+            glm::vec3 offset = vertex.position - center;
+            radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+        }
+        boundingSphere = glm::vec4{center, glm::sqrt(radiusSquared)};
     }
 
     std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptions() {
@@ -13,6 +13,7 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -50,12 +51,29 @@ namespace lve {
         static std::unique_ptr<LveModel> createModelFromFile(LveDevice &device, const std::string &filepath);
 
         void bind(VkCommandBuffer commandBuffer);
-        void draw(VkCommandBuffer commandBuffer);
+        void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+        // Draws from a command written by writeIndirectCommand. Both command layouts keep
+        // instanceCount as their second uint, so a compute shader can fill either.
+        static constexpr VkDeviceSize INDIRECT_COMMAND_SIZE = sizeof(VkDrawIndexedIndirectCommand);
+        void writeIndirectCommand(void *command, uint32_t instanceCount, uint32_t firstInstance) const;
+        void drawIndirect(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset);
+
+        uint32_t getId() const { return id; }  // small unique number for render queue sort keys
+
+        // Model space bounding sphere, xyz center and w radius.
+        const glm::vec4 &getBoundingSphere() const { return boundingSphere; }
+        // Model space axis aligned bounding box.
+        const glm::vec3 &getBoundingBoxMin() const { return boundingBoxMin; }
+        const glm::vec3 &getBoundingBoxMax() const { return boundingBoxMax; }
       private:
         void createVertexBuffers(const std::vector<Vertex> &vertices);
         void createIndexBuffers(const std::vector<uint32_t> &indices);
+        void computeBounds(const std::vector<Vertex> &vertices);
 
         LveDevice& lveDevice;
+        inline static std::atomic<uint32_t> nextId{0};
+        uint32_t id = nextId++;
 
         std::unique_ptr<LveBuffer> vertexBuffer;
         uint32_t vertexCount;
@@ -63,6 +81,10 @@ namespace lve {
         bool hasIndexBuffer = false;
         std::unique_ptr<LveBuffer> indexBuffer;
         uint32_t indexCount;
+
+        glm::vec4 boundingSphere{0.f};
+        glm::vec3 boundingBoxMin{0.f};
+        glm::vec3 boundingBoxMax{0.f};
     };
 }
 
@@ -0,0 +1,41 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+#include "lve_occluder.hpp"
+#include "lve_model.hpp"
+
+namespace lve {
+
+    std::shared_ptr<LveOccluder> LveOccluder::createBox(const glm::vec3 &min, const glm::vec3 &max) {
+        auto occluder = std::make_shared<LveOccluder>();
+        for (uint32_t corner = 0; corner < 8; corner++) {
+            occluder->positions.emplace_back(
+                    corner & 1 ? max.x : min.x,
+                    corner & 2 ? max.y : min.y,
+                    corner & 4 ? max.z : min.z);
+        }
+        // Two triangles per face, corners numbered by their x, y and z bits.
+        occluder->indices = {
+                0, 2, 3, 0, 3, 1,  // -z
+                4, 5, 7, 4, 7, 6,  // +z
+                0, 4, 6, 0, 6, 2,  // -x
+                1, 3, 7, 1, 7, 5,  // +x
+                0, 1, 5, 0, 5, 4,  // -y
+                2, 6, 7, 2, 7, 3,  // +y
+        };
+        return occluder;
+    }
+
+    std::shared_ptr<LveOccluder> LveOccluder::createFromFile(const std::string &filepath) {
+        LveModel::Builder builder{};
+        builder.loadModel(filepath);
+
+        auto occluder = std::make_shared<LveOccluder>();
+        occluder->positions.reserve(builder.vertices.size());
+        for (const auto &vertex : builder.vertices) {
+            occluder->positions.push_back(vertex.position);
+        }
+        occluder->indices = std::move(builder.indices);
+        return occluder;
+    }
+}
@@ -0,0 +1,37 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_OCCLUDER_HPP
+#define VULKANTEST_LVE_OCCLUDER_HPP
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+    // Model space triangles that LveOcclusionRasterizer draws for a game object in place of its
+    // model. Only geometry that really is solid may go in: an occluder sticking out of the model
+    // it stands for would hide objects that can be seen. Triangles are double sided.
+    class LveOccluder {
+    public:
+        // The six faces of a box, e.g. one inscribed in a round model.
+        static std::shared_ptr<LveOccluder> createBox(const glm::vec3 &min, const glm::vec3 &max);
+        // The full geometry of an obj file, for models that are cheap enough to draw as they are.
+        static std::shared_ptr<LveOccluder> createFromFile(const std::string &filepath);
+
+        uint32_t getTriangleCount() const { return static_cast<uint32_t>(indices.size() / 3); }
+
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;  // three per triangle
+    };
+}
+
+#endif //VULKANTEST_LVE_OCCLUDER_HPP
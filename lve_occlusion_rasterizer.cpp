@@ -0,0 +1,400 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+#include "lve_occlusion_rasterizer.hpp"
+
+#if defined(__AVX__)
+#define LVE_OCCLUSION_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_OCCLUSION_SSE
+#include <emmintrin.h>
+#endif
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+namespace lve {
+
+    namespace {
+        using Clock = std::chrono::high_resolution_clock;
+
+        double millisecondsSince(Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        // Frustum planes a clip space position is outside of, one bit each.
+        uint32_t outcode(const glm::vec4 &position) {
+            return (position.x < -position.w ? 1u : 0u) | (position.x > position.w ? 2u : 0u) |
+                   (position.y < -position.w ? 4u : 0u) | (position.y > position.w ? 8u : 0u) |
+                   (position.z < 0.f ? 16u : 0u) | (position.z > position.w ? 32u : 0u);
+        }
+
+        constexpr uint32_t NEAR_PLANE_BIT = 16u;
+    }
+
+    LveOcclusionRasterizer::LveOcclusionRasterizer(uint32_t width, uint32_t height) {
+        assert(width > 0 && height > 0 && "Occlusion buffer must not be empty");
+        tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        this->width = tilesX * TILE_SIZE;
+        this->height = tilesY * TILE_SIZE;
+        depth.assign(static_cast<size_t>(this->width) * this->height, 1.f);
+        tileMaxDepth.assign(static_cast<size_t>(tilesX) * tilesY, 1.f);
+    }
+
+    void LveOcclusionRasterizer::begin(const glm::mat4 &frameViewProjection) {
+        viewProjection = frameViewProjection;
+        triangles.clear();
+        boxes.clear();
+        stats = Stats{};
+    }
+
+    void LveOcclusionRasterizer::addOccluder(const LveOccluder &occluder, const glm::mat4 &modelMatrix) {
+        auto start = Clock::now();
+        glm::mat4 modelViewProjection = viewProjection * modelMatrix;
+        clipPositions.clear();
+        for (const auto &position : occluder.positions) {
+            clipPositions.push_back(modelViewProjection * glm::vec4{position, 1.f});
+        }
+
+        for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3) {
+            glm::vec4 vertices[3] = {
+                    clipPositions[occluder.indices[i]],
+                    clipPositions[occluder.indices[i + 1]],
+                    clipPositions[occluder.indices[i + 2]]};
+            uint32_t codes[3] = {outcode(vertices[0]), outcode(vertices[1]), outcode(vertices[2])};
+            if ((codes[0] & codes[1] & codes[2]) != 0) {
+                continue;  // all three corners are outside the same plane
+            }
+            if (((codes[0] | codes[1] | codes[2]) & NEAR_PLANE_BIT) == 0) {
+                addTriangle(vertices[0], vertices[1], vertices[2]);
+                continue;
+            }
+
+            // Cutting one corner off leaves a quad, cutting two leaves a triangle.
+            glm::vec4 polygon[4];
+            uint32_t count = 0;
+            for (uint32_t edge = 0; edge < 3; edge++) {
+                const glm::vec4 &from = vertices[edge];
+                const glm::vec4 &to = vertices[(edge + 1) % 3];
+                if (from.z >= 0.f) {
+                    polygon[count++] = from;
+                }
+                if ((from.z >= 0.f) != (to.z >= 0.f)) {
+                    polygon[count++] = from + (to - from) * (from.z / (from.z - to.z));
+                }
+            }
+            for (uint32_t k = 1; k + 1 < count; k++) {
+                addTriangle(polygon[0], polygon[k], polygon[k + 1]);
+            }
+        }
+        stats.setupMilliseconds += millisecondsSince(start);
+    }
+
+    void LveOcclusionRasterizer::addTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c) {
+        // Pixel coordinates, y down like the framebuffer. The setup is done in double precision,
+        // since clipped triangles can reach far off screen.
+        const glm::vec4 *clip[3] = {&a, &b, &c};
+        double x[3], y[3], z[3];
+        for (uint32_t i = 0; i < 3; i++) {
+            if (clip[i]->w <= 0.f) {
+                return;
+            }
+            double invW = 1.0 / clip[i]->w;
+            x[i] = (clip[i]->x * invW * 0.5 + 0.5) * width;
+            y[i] = (clip[i]->y * invW * 0.5 + 0.5) * height;
+            z[i] = clip[i]->z * invW;
+        }
+
+        double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (area == 0.0) {
+            return;
+        }
+        if (area < 0.0) {
+            // Occluders are double sided; turn the triangle around so the inside is positive.
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(z[1], z[2]);
+            area = -area;
+        }
+
+        // Pixels whose centers are inside the triangle's bounds.
+        double boundsMinX = std::max(std::ceil(std::min({x[0], x[1], x[2]}) - 0.5), 0.0);
+        double boundsMaxX = std::min(std::floor(std::max({x[0], x[1], x[2]}) - 0.5), width - 1.0);
+        double boundsMinY = std::max(std::ceil(std::min({y[0], y[1], y[2]}) - 0.5), 0.0);
+        double boundsMaxY = std::min(std::floor(std::max({y[0], y[1], y[2]}) - 0.5), height - 1.0);
+        if (boundsMinX > boundsMaxX || boundsMinY > boundsMaxY) {
+            return;
+        }
+
+        Triangle triangle{};
+        triangle.minX = static_cast<int32_t>(boundsMinX);
+        triangle.maxX = static_cast<int32_t>(boundsMaxX);
+        triangle.minY = static_cast<int32_t>(boundsMinY);
+        triangle.maxY = static_cast<int32_t>(boundsMaxY);
+        double originX = boundsMinX + 0.5;
+        double originY = boundsMinY + 0.5;
+
+        for (uint32_t i = 0; i < 3; i++) {
+            uint32_t j = (i + 1) % 3;
+            triangle.edgeStepX[i] = static_cast<float>(y[i] - y[j]);
+            triangle.edgeStepY[i] = static_cast<float>(x[j] - x[i]);
+            triangle.edgeOrigin[i] = static_cast<float>((x[j] - x[i]) * (originY - y[i]) - (y[j] - y[i]) * (originX - x[i]));
+        }
+
+        double depthStepX = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+        double depthStepY = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+        triangle.depthStepX = static_cast<float>(depthStepX);
+        triangle.depthStepY = static_cast<float>(depthStepY);
+        triangle.depthOrigin = static_cast<float>(z[0] + depthStepX * (originX - x[0]) + depthStepY * (originY - y[0]));
+        // Rounding on slivers must not pull the surface nearer than any of its corners.
+        triangle.minDepth = static_cast<float>(std::min({z[0], z[1], z[2]}));
+
+        triangles.push_back(triangle);
+        stats.occluderTriangles++;
+    }
+
+    void LveOcclusionRasterizer::rasterize(LveThreadPool *threadPool) {
+        auto start = Clock::now();
+        // One task per row of tiles; they write disjoint rows, and the pool hands them out as
+        // threads come free, so rows crowded with triangles do not hold the others up.
+        auto rasterizeTileRow = [this](uint32_t tileRow) {
+            rasterizeRows(static_cast<int32_t>(tileRow * TILE_SIZE), static_cast<int32_t>((tileRow + 1) * TILE_SIZE));
+        };
+        if (threadPool != nullptr && threadPool->getThreadCount() > 1 && !triangles.empty()) {
+            threadPool->parallelFor(tilesY, rasterizeTileRow);
+        } else {
+            for (uint32_t tileRow = 0; tileRow < tilesY; tileRow++) {
+                rasterizeTileRow(tileRow);
+            }
+        }
+        stats.rasterizeMilliseconds = millisecondsSince(start);
+    }
+
+    void LveOcclusionRasterizer::rasterizeRows(int32_t rowBegin, int32_t rowEnd) {
+        std::fill(depth.begin() + static_cast<size_t>(rowBegin) * width,
+                  depth.begin() + static_cast<size_t>(rowEnd) * width, 1.f);
+        for (const auto &triangle : triangles) {
+            if (triangle.maxY < rowBegin || triangle.minY >= rowEnd) {
+                continue;
+            }
+            rasterizeTriangle(triangle, std::max(rowBegin, triangle.minY), std::min(rowEnd, triangle.maxY + 1));
+        }
+
+        const int32_t tileSize = static_cast<int32_t>(TILE_SIZE);
+        for (int32_t tileY = rowBegin / tileSize; tileY < rowEnd / tileSize; tileY++) {
+            for (uint32_t tileX = 0; tileX < tilesX; tileX++) {
+                float maxDepth = 0.f;
+                for (uint32_t y = 0; y < TILE_SIZE; y++) {
+                    const float *row = &depth[(static_cast<size_t>(tileY) * TILE_SIZE + y) * width + tileX * TILE_SIZE];
+                    for (uint32_t x = 0; x < TILE_SIZE; x++) {
+                        maxDepth = std::max(maxDepth, row[x]);
+                    }
+                }
+                tileMaxDepth[static_cast<size_t>(tileY) * tilesX + tileX] = maxDepth;
+            }
+        }
+    }
+
+    void LveOcclusionRasterizer::rasterizeTriangle(const Triangle &triangle, int32_t rowBegin, int32_t rowEnd) {
+        // Blocks start on a multiple of the lane count, and the width is a whole number of tiles,
+        // so a block never runs past the end of a row.
+#if defined(LVE_OCCLUSION_AVX)
+        const __m256 lanes = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 edgeStepX0 = _mm256_set1_ps(triangle.edgeStepX[0]);
+        const __m256 edgeStepX1 = _mm256_set1_ps(triangle.edgeStepX[1]);
+        const __m256 edgeStepX2 = _mm256_set1_ps(triangle.edgeStepX[2]);
+        const __m256 depthStepX = _mm256_set1_ps(triangle.depthStepX);
+        const __m256 minDepth = _mm256_set1_ps(triangle.minDepth);
+#elif defined(LVE_OCCLUSION_SSE)
+        const __m128 lanes = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 edgeStepX0 = _mm_set1_ps(triangle.edgeStepX[0]);
+        const __m128 edgeStepX1 = _mm_set1_ps(triangle.edgeStepX[1]);
+        const __m128 edgeStepX2 = _mm_set1_ps(triangle.edgeStepX[2]);
+        const __m128 depthStepX = _mm_set1_ps(triangle.depthStepX);
+        const __m128 minDepth = _mm_set1_ps(triangle.minDepth);
+#endif
+
+        for (int32_t y = rowBegin; y < rowEnd; y++) {
+            float dy = static_cast<float>(y - triangle.minY);
+            float rowEdge[3];
+            for (uint32_t i = 0; i < 3; i++) {
+                rowEdge[i] = triangle.edgeOrigin[i] + triangle.edgeStepY[i] * dy;
+            }
+            float rowDepth = triangle.depthOrigin + triangle.depthStepY * dy;
+            float *row = &depth[static_cast<size_t>(y) * width];
+
+#if defined(LVE_OCCLUSION_AVX)
+            const __m256 rowEdge0 = _mm256_set1_ps(rowEdge[0]);
+            const __m256 rowEdge1 = _mm256_set1_ps(rowEdge[1]);
+            const __m256 rowEdge2 = _mm256_set1_ps(rowEdge[2]);
+            const __m256 rowDepthV = _mm256_set1_ps(rowDepth);
+            for (int32_t x = triangle.minX & ~7; x <= triangle.maxX; x += 8) {
+                __m256 dx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x - triangle.minX)), lanes);
+                __m256 e0 = _mm256_add_ps(rowEdge0, _mm256_mul_ps(edgeStepX0, dx));
+                __m256 e1 = _mm256_add_ps(rowEdge1, _mm256_mul_ps(edgeStepX1, dx));
+                __m256 e2 = _mm256_add_ps(rowEdge2, _mm256_mul_ps(edgeStepX2, dx));
+                __m256 inside = _mm256_and_ps(
+                        _mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+                        _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+                if (_mm256_movemask_ps(inside) == 0) {
+                    continue;
+                }
+                __m256 z = _mm256_max_ps(_mm256_add_ps(rowDepthV, _mm256_mul_ps(depthStepX, dx)), minDepth);
+                __m256 previous = _mm256_loadu_ps(row + x);
+                _mm256_storeu_ps(row + x, _mm256_blendv_ps(previous, _mm256_min_ps(previous, z), inside));
+            }
+#elif defined(LVE_OCCLUSION_SSE)
+            const __m128 rowEdge0 = _mm_set1_ps(rowEdge[0]);
+            const __m128 rowEdge1 = _mm_set1_ps(rowEdge[1]);
+            const __m128 rowEdge2 = _mm_set1_ps(rowEdge[2]);
+            const __m128 rowDepthV = _mm_set1_ps(rowDepth);
+            for (int32_t x = triangle.minX & ~3; x <= triangle.maxX; x += 4) {
+                __m128 dx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x - triangle.minX)), lanes);
+                __m128 e0 = _mm_add_ps(rowEdge0, _mm_mul_ps(edgeStepX0, dx));
+                __m128 e1 = _mm_add_ps(rowEdge1, _mm_mul_ps(edgeStepX1, dx));
+                __m128 e2 = _mm_add_ps(rowEdge2, _mm_mul_ps(edgeStepX2, dx));
+                __m128 inside = _mm_and_ps(
+                        _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+                __m128 z = _mm_max_ps(_mm_add_ps(rowDepthV, _mm_mul_ps(depthStepX, dx)), minDepth);
+                __m128 previous = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(previous, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, previous)));
+            }
+#else
+            for (int32_t x = triangle.minX; x <= triangle.maxX; x++) {
+                float dx = static_cast<float>(x - triangle.minX);
+                if (rowEdge[0] + triangle.edgeStepX[0] * dx >= 0.f &&
+                    rowEdge[1] + triangle.edgeStepX[1] * dx >= 0.f &&
+                    rowEdge[2] + triangle.edgeStepX[2] * dx >= 0.f) {
+                    float z = std::max(rowDepth + triangle.depthStepX * dx, triangle.minDepth);
+                    row[x] = std::min(row[x], z);
+                }
+            }
+#endif
+        }
+    }
+
+    void LveOcclusionRasterizer::addBox(const glm::mat4 &modelMatrix, const glm::vec3 &boxMin, const glm::vec3 &boxMax) {
+        boxes.push_back({viewProjection * modelMatrix, boxMin, boxMax});
+    }
+
+    void LveOcclusionRasterizer::cull(std::vector<uint32_t> &visible) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < boxes.size(); i++) {
+            if (isVisible(boxes[i])) {
+                visible.push_back(static_cast<uint32_t>(i));
+            } else {
+                stats.occluded++;
+            }
+        }
+        stats.tested += static_cast<uint32_t>(boxes.size());
+        stats.testMilliseconds += millisecondsSince(start);
+        boxes.clear();
+    }
+
+    bool LveOcclusionRasterizer::isVisible(const Box &box) const {
+        // Screen rectangle and nearest depth of the eight corners.
+        float minX = FLT_MAX;
+        float minY = FLT_MAX;
+        float maxX = -FLT_MAX;
+        float maxY = -FLT_MAX;
+        float nearestDepth = 1.f;  // past the far plane counts as the far plane, where nothing is drawn
+        for (uint32_t corner = 0; corner < 8; corner++) {
+            glm::vec4 clip = box.modelViewProjection * glm::vec4{
+                    corner & 1 ? box.max.x : box.min.x,
+                    corner & 2 ? box.max.y : box.min.y,
+                    corner & 4 ? box.max.z : box.min.z,
+                    1.f};
+            if (clip.z < 0.f || clip.w <= 0.f) {
+                return true;  // reaches past the near plane, so it may cover the whole view
+            }
+            float invW = 1.f / clip.w;
+            float x = (clip.x * invW * 0.5f + 0.5f) * width;
+            float y = (clip.y * invW * 0.5f + 0.5f) * height;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            nearestDepth = std::min(nearestDepth, clip.z * invW);
+        }
+        if (maxX < 0.f || maxY < 0.f || minX >= width || minY >= height) {
+            return true;  // off screen; that is for frustum culling to decide
+        }
+
+        // Every pixel the rectangle touches, not only those whose centers it covers.
+        int32_t x0 = std::max(static_cast<int32_t>(std::floor(minX)), 0);
+        int32_t y0 = std::max(static_cast<int32_t>(std::floor(minY)), 0);
+        int32_t x1 = std::min(static_cast<int32_t>(std::floor(maxX)), static_cast<int32_t>(width) - 1);
+        int32_t y1 = std::min(static_cast<int32_t>(std::floor(maxY)), static_cast<int32_t>(height) - 1);
+        const int32_t tileSize = static_cast<int32_t>(TILE_SIZE);
+        for (int32_t tileY = y0 / tileSize; tileY <= y1 / tileSize; tileY++) {
+            for (int32_t tileX = x0 / tileSize; tileX <= x1 / tileSize; tileX++) {
+                if (tileMaxDepth[static_cast<size_t>(tileY) * tilesX + tileX] < nearestDepth) {
+                    continue;  // the whole tile is in front of the box
+                }
+                if (isAnyPixelBehind(
+                        std::max(x0, tileX * tileSize), std::max(y0, tileY * tileSize),
+                        std::min(x1, tileX * tileSize + tileSize - 1), std::min(y1, tileY * tileSize + tileSize - 1),
+                        nearestDepth)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool LveOcclusionRasterizer::isAnyPixelBehind(int32_t x0, int32_t y0, int32_t x1, int32_t y1, float boxDepth) const {
+#if defined(LVE_OCCLUSION_AVX)
+        // The span lies inside one tile, which is exactly one block of eight.
+        int32_t blockX = x0 & ~7;
+        const __m256 lanes = _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+        const __m256 inSpan = _mm256_and_ps(
+                _mm256_cmp_ps(lanes, _mm256_set1_ps(static_cast<float>(x0 - blockX)), _CMP_GE_OQ),
+                _mm256_cmp_ps(lanes, _mm256_set1_ps(static_cast<float>(x1 - blockX)), _CMP_LE_OQ));
+        const __m256 boxDepthV = _mm256_set1_ps(boxDepth);
+        for (int32_t y = y0; y <= y1; y++) {
+            __m256 pixels = _mm256_loadu_ps(&depth[static_cast<size_t>(y) * width + blockX]);
+            if (_mm256_movemask_ps(_mm256_and_ps(inSpan, _mm256_cmp_ps(pixels, boxDepthV, _CMP_GE_OQ))) != 0) {
+                return true;
+            }
+        }
+        return false;
+#elif defined(LVE_OCCLUSION_SSE)
+        const __m128 lanes = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+        const __m128 boxDepthV = _mm_set1_ps(boxDepth);
+        for (int32_t blockX = x0 & ~3; blockX <= x1; blockX += 4) {
+            const __m128 inSpan = _mm_and_ps(
+                    _mm_cmpge_ps(lanes, _mm_set1_ps(static_cast<float>(x0 - blockX))),
+                    _mm_cmple_ps(lanes, _mm_set1_ps(static_cast<float>(x1 - blockX))));
+            for (int32_t y = y0; y <= y1; y++) {
+                __m128 pixels = _mm_loadu_ps(&depth[static_cast<size_t>(y) * width + blockX]);
+                if (_mm_movemask_ps(_mm_and_ps(inSpan, _mm_cmpge_ps(pixels, boxDepthV))) != 0) {
+                    return true;
+                }
+            }
+        }
+        return false;
+#else
+        for (int32_t y = y0; y <= y1; y++) {
+            const float *row = &depth[static_cast<size_t>(y) * width];
+            for (int32_t x = x0; x <= x1; x++) {
+                if (row[x] >= boxDepth) {
+                    return true;
+                }
+            }
+        }
+        return false;
+#endif
+    }
+}
@@ -0,0 +1,107 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_OCCLUSION_RASTERIZER_HPP
+#define VULKANTEST_LVE_OCCLUSION_RASTERIZER_HPP
+
+#include "lve_occluder.hpp"
+#include "lve_thread_pool.hpp"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+    // Software occlusion culling for the CPU render path. A few large occluders are drawn into a
+    // small depth buffer on the CPU, and object bounding boxes are then tested against it, so
+    // objects hidden behind them are dropped before any draw is recorded. Triangles are filled
+    // 8 pixels at a time with AVX, 4 with SSE, or one by one on other targets, in horizontal
+    // bands spread over the thread pool. Each 8x8 tile also keeps its farthest depth, so most
+    // boxes are settled by the tiles they cover without reading single pixels.
+    class LveOcclusionRasterizer {
+    public:
+        struct Stats {
+            uint32_t occluderTriangles = 0;  // after clipping to the near plane
+            uint32_t tested = 0;
+            uint32_t occluded = 0;
+            double setupMilliseconds = 0.0;  // transforming and clipping the occluders
+            double rasterizeMilliseconds = 0.0;
+            double testMilliseconds = 0.0;
+        };
+
+        static constexpr uint32_t TILE_SIZE = 8;
+
+        // The size is rounded up to whole tiles.
+        LveOcclusionRasterizer(uint32_t width = 256, uint32_t height = 192);
+
+        // Clears the depth buffer and the queued occluders and boxes for a new frame seen
+        // through viewProjection (the camera's projection times view).
+        void begin(const glm::mat4 &frameViewProjection);
+        // Transforms the occluder's triangles, clips them to the near plane and queues them.
+        void addOccluder(const LveOccluder &occluder, const glm::mat4 &modelMatrix);
+        // Draws the queued triangles; the work is split over the pool's threads when given one.
+        void rasterize(LveThreadPool *threadPool = nullptr);
+
+        // Queues the bounding box of an object for the next cull, in model space.
+        void addBox(const glm::mat4 &modelMatrix, const glm::vec3 &boxMin, const glm::vec3 &boxMax);
+        // Appends the indices, in add order, of the boxes that are not completely hidden behind
+        // the occluders, and clears the queue.
+        void cull(std::vector<uint32_t> &visible);
+
+        uint32_t getWidth() const { return width; }
+        uint32_t getHeight() const { return height; }
+        // Row major, [0, 1] with 1 where no occluder was drawn.
+        const std::vector<float> &getDepth() const { return depth; }
+        const Stats &getStats() const { return stats; }
+
+    private:
+        // Edge functions and depth as planes over the pixel grid, evaluated relative to the
+        // center of pixel (minX, minY); edges are >= 0 inside.
+        struct Triangle {
+            float edgeStepX[3];
+            float edgeStepY[3];
+            float edgeOrigin[3];
+            float depthStepX;
+            float depthStepY;
+            float depthOrigin;
+            float minDepth;
+            int32_t minX;
+            int32_t maxX;
+            int32_t minY;
+            int32_t maxY;
+        };
+
+        struct Box {
+            glm::mat4 modelViewProjection;
+            glm::vec3 min;
+            glm::vec3 max;
+        };
+
+        void addTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c);
+        void rasterizeRows(int32_t rowBegin, int32_t rowEnd);
+        void rasterizeTriangle(const Triangle &triangle, int32_t rowBegin, int32_t rowEnd);
+        bool isVisible(const Box &box) const;
+        bool isAnyPixelBehind(int32_t x0, int32_t y0, int32_t x1, int32_t y1, float boxDepth) const;
+
+        uint32_t width;
+        uint32_t height;
+        uint32_t tilesX;
+        uint32_t tilesY;
+        glm::mat4 viewProjection{1.f};
+        std::vector<float> depth;
+        std::vector<float> tileMaxDepth;
+        std::vector<Triangle> triangles;
+        std::vector<glm::vec4> clipPositions;  // scratch for addOccluder
+        std::vector<Box> boxes;
+        Stats stats;
+    };
+}
+
+#endif //VULKANTEST_LVE_OCCLUSION_RASTERIZER_HPP
@@ -4,10 +4,10 @@
 #include "lve_pipeline.hpp"
 #include "lve_model.hpp"
 
-#include <fstream>
 #include <stdexcept>
 #include <iostream>
 #include <cassert>
+#include <chrono>
 
 namespace lve {
 
@@ -16,37 +16,22 @@ namespace lve {
         createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
     }
 
-    LvePipeline::~LvePipeline() {
-        vkDestroyShaderModule(lveDevice.device(), fragShaderModule, nullptr);
-        vkDestroyShaderModule(lveDevice.device(), vertShaderModule, nullptr);
-        vkDestroyPipeline(lveDevice.device(), graphicsPipeline, nullptr);
+    LvePipeline::LvePipeline(LveDevice &device, const std::string &compFilepath, VkPipelineLayout pipelineLayout)
+            : lveDevice{device}, bindPoint{VK_PIPELINE_BIND_POINT_COMPUTE} {
+        createComputePipeline(compFilepath, pipelineLayout);
     }
 
-    std::vector<char> LvePipeline::readFile(const std::string &filename)
-    {
-        std::ifstream file{filename, std::ios::ate | std::ios::binary};
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open file: " + filename);
-        }
-
-        size_t fileSize = static_cast<size_t>(file.tellg());
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-
-        file.close();
-        return buffer;
+    LvePipeline::~LvePipeline() {
+        vkDestroyPipeline(lveDevice.device(), graphicsPipeline, nullptr);
     }
 
     void LvePipeline::createGraphicsPipeline(const std::string &vertFilepath, const std::string &fragFilepath, const PipelineConfigInfo &configInfo) {
         assert(configInfo.pipelineLayout != nullptr && "Cannot create graphics pipeline:: no pipelineLayout provided in configInfo");
         assert(configInfo.renderPass != nullptr && "Cannot create graphics pipeline:: no renderPass provided in configInfo");
-        auto vertCode = readFile(vertFilepath);
-        auto fragCode = readFile(fragFilepath);
-
-        createShaderModule(vertCode, &vertShaderModule);
-        createShaderModule(fragCode, &fragShaderModule);
+        auto &shaderModules = lveDevice.shaderModules();
+        VkShaderModule vertShaderModule = shaderModules.get(vertFilepath);
+        bool hasFragmentShader = !fragFilepath.empty();
+        VkShaderModule fragShaderModule = hasFragmentShader ? shaderModules.get(fragFilepath) : VK_NULL_HANDLE;
 
         VkPipelineShaderStageCreateInfo shaderStages[2];
         shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -76,7 +61,7 @@ namespace lve {
 
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
+        pipelineInfo.stageCount = hasFragmentShader ? 2 : 1;
         pipelineInfo.pStages = shaderStages;
         pipelineInfo.pVertexInputState = &vertexInputInfo;
         pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -94,25 +79,44 @@ namespace lve {
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
         pipelineInfo.basePipelineIndex = -1;
 
-        if (vkCreateGraphicsPipelines(lveDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+        auto &pipelineCache = lveDevice.pipelineCache();
+        auto start = std::chrono::high_resolution_clock::now();
+        if (vkCreateGraphicsPipelines(lveDevice.device(), pipelineCache.getCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
+        pipelineCache.recordCreation(std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start).count());
 
     }
 
-    void LvePipeline::createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule) {
-        VkShaderModuleCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+    void LvePipeline::createComputePipeline(const std::string &compFilepath, VkPipelineLayout pipelineLayout) {
+        assert(pipelineLayout != nullptr && "Cannot create compute pipeline:: no pipelineLayout provided");
+        VkShaderModule compShaderModule = lveDevice.shaderModules().get(compFilepath);
 
-        if (vkCreateShaderModule(lveDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create shader module!");
+        VkPipelineShaderStageCreateInfo shaderStage{};
+        shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shaderStage.module = compShaderModule;
+        shaderStage.pName = "main";
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = shaderStage;
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.basePipelineIndex = -1;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        auto &pipelineCache = lveDevice.pipelineCache();
+        auto start = std::chrono::high_resolution_clock::now();
+        if (vkCreateComputePipelines(lveDevice.device(), pipelineCache.getCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute pipeline");
         }
+        pipelineCache.recordCreation(std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - start).count());
     }
 
     void LvePipeline::bind(VkCommandBuffer commandBuffer) {
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        vkCmdBindPipeline(commandBuffer, bindPoint, graphicsPipeline);
     }
 
     void LvePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
@@ -198,4 +202,15 @@ namespace lve {
         configInfo.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
         configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
     }
+
+    void LvePipeline::enableDepthPrepass(PipelineConfigInfo &configInfo) {
+        configInfo.colorBlendAttachment.colorWriteMask = 0;
+        configInfo.attributeDescriptions = {
+                {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LveModel::Vertex, position)}};
+    }
+
+    void LvePipeline::enableDepthEqualTest(PipelineConfigInfo &configInfo) {
+        configInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+        configInfo.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+    }
 }
@@ -7,6 +7,7 @@
 
 #include "lve_device.hpp"
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -36,24 +37,32 @@ namespace lve {
     class LvePipeline {
 
     public:
+        // An empty fragFilepath makes a vertex only pipeline, e.g. for depth only passes.
         LvePipeline(LveDevice &device, const std::string &vertFilepath, const std::string &fragFilepath, const PipelineConfigInfo &configInfo);
+        // Compute pipeline
+        LvePipeline(LveDevice &device, const std::string &compFilepath, VkPipelineLayout pipelineLayout);
         ~LvePipeline();
         LvePipeline(const LvePipeline&) = delete;
         LvePipeline &operator=(const LvePipeline&) = delete;
 
         void bind(VkCommandBuffer commandBuffer);
+        uint32_t getId() const { return id; }  // small unique number for render queue sort keys
         static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
         static void enableAlphaBlending(PipelineConfigInfo& configInfo);
+        // Depth prepass: positions only and no color writes. The pass drawn after it with
+        // enableDepthEqualTest shades only the fragments whose depth was kept.
+        static void enableDepthPrepass(PipelineConfigInfo& configInfo);
+        static void enableDepthEqualTest(PipelineConfigInfo& configInfo);
 
     private:
-        static std::vector<char> readFile(const std::string &filename);
         void createGraphicsPipeline(const std::string &vertFilepath, const std::string &fragFilepath, const PipelineConfigInfo &configInfo);
-        void createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule);
+        void createComputePipeline(const std::string &compFilepath, VkPipelineLayout pipelineLayout);
 
         LveDevice &lveDevice;
+        inline static std::atomic<uint32_t> nextId{0};
+        uint32_t id = nextId++;
         VkPipeline graphicsPipeline;
-        VkShaderModule vertShaderModule;
-        VkShaderModule fragShaderModule;
+        VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 
     };
 
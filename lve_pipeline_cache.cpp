@@ -0,0 +1,129 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#include "lve_pipeline_cache.hpp"
+
+// std
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace lve {
+
+    LvePipelineCache::LvePipelineCache(VkDevice device, const VkPhysicalDeviceProperties &properties, std::string path)
+            : device{device}, properties{properties}, path{std::move(path)} {
+        std::vector<char> data;
+        loadResult = "no cache file";
+        std::ifstream file{this->path, std::ios::ate | std::ios::binary};
+        if (file.is_open()) {
+            data.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(data.data(), static_cast<std::streamsize>(data.size()));
+            const char *rejection = file ? checkHeader(data) : "could not be read";
+            loadResult = rejection != nullptr ? rejection : "loaded";
+            loadedBytes = rejection != nullptr ? 0 : data.size();
+        }
+
+        VkPipelineCacheCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.initialDataSize = loadedBytes;
+        createInfo.pInitialData = loadedBytes > 0 ? data.data() : nullptr;
+        VkResult result = vkCreatePipelineCache(device, &createInfo, nullptr, &cache);
+        if (result != VK_SUCCESS && loadedBytes > 0) {
+            // Data that passed the header check can still be refused; start over empty then.
+            loadedBytes = 0;
+            loadResult = "rejected by the driver";
+            createInfo.initialDataSize = 0;
+            createInfo.pInitialData = nullptr;
+            result = vkCreatePipelineCache(device, &createInfo, nullptr, &cache);
+        }
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+
+    LvePipelineCache::~LvePipelineCache() {
+        if (!save()) {
+            std::cerr << "failed to save the pipeline cache to " << path << std::endl;
+        }
+        vkDestroyPipelineCache(device, cache, nullptr);
+    }
+
+    const char *LvePipelineCache::checkHeader(const std::vector<char> &data) const {
+        // VkPipelineCacheHeaderVersionOne: header size, header version, vendor id and device id as
+        // 32 bit values, then the pipeline cache UUID.
+        constexpr size_t HEADER_SIZE = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+        if (data.size() < HEADER_SIZE) {
+            return "file too small";
+        }
+        uint32_t fields[4];
+        std::memcpy(fields, data.data(), sizeof(fields));
+        if (fields[0] < HEADER_SIZE || fields[0] > data.size()) {
+            return "bad header size";
+        }
+        if (fields[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+            return "unknown header version";
+        }
+        if (fields[2] != properties.vendorID || fields[3] != properties.deviceID) {
+            return "made for another GPU";
+        }
+        if (std::memcmp(data.data() + sizeof(fields), properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            return "made by another driver version";
+        }
+        return nullptr;
+    }
+
+    void LvePipelineCache::recordCreation(double milliseconds) {
+        pipelinesCreated++;
+        creationNanoseconds += static_cast<uint64_t>(milliseconds * 1e6);
+    }
+
+    bool LvePipelineCache::save() const {
+        size_t size = 0;
+        if (vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS) {
+            return false;
+        }
+        std::vector<char> data(size);
+        if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS) {
+            return false;
+        }
+
+        std::error_code error;
+        const std::string temporaryPath = path + ".tmp";
+        std::ofstream file{temporaryPath, std::ios::binary | std::ios::trunc};
+        file.write(data.data(), static_cast<std::streamsize>(size));
+        file.close();
+        if (!file) {
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+        // Replaces the old file in one step, so readers see either the old cache or the new one.
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error) {
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+        return true;
+    }
+
+    LvePipelineCache::Stats LvePipelineCache::getStats() const {
+        Stats stats{};
+        stats.loadedBytes = loadedBytes;
+        stats.loadResult = loadResult;
+        stats.pipelinesCreated = pipelinesCreated;
+        stats.creationMilliseconds = static_cast<double>(creationNanoseconds) / 1e6;
+        return stats;
+    }
+
+    void LvePipelineCache::printStats(std::ostream &out) const {
+        Stats stats = getStats();
+        out << "pipeline cache: " << (stats.loadedBytes > 0 ? "warm" : "cold") << " start ("
+            << stats.loadResult << ", " << stats.loadedBytes << " bytes), " << stats.pipelinesCreated
+            << " pipelines created in " << stats.creationMilliseconds << " ms" << std::endl;
+    }
+}
@@ -0,0 +1,66 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_PIPELINE_CACHE_HPP
+#define VULKANTEST_LVE_PIPELINE_CACHE_HPP
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+    // Device wide VkPipelineCache kept on disk between runs, so only the first launch (or the
+    // first after a driver or GPU change) pays for compiling every pipeline. The file is only
+    // used when its header matches this device's vendor id, device id and pipeline cache UUID,
+    // and it is written to a temporary file and renamed over the old one, so a crash while
+    // saving never leaves a truncated cache behind.
+    class LvePipelineCache {
+    public:
+        struct Stats {
+            size_t loadedBytes = 0;         // 0 on a cold start
+            const char *loadResult = "";    // why the file was or was not used
+            uint32_t pipelinesCreated = 0;
+            double creationMilliseconds = 0.0;  // summed over all pipeline creations
+        };
+
+        LvePipelineCache(VkDevice device, const VkPhysicalDeviceProperties &properties, std::string path);
+        // Saves the cache, so it must be destroyed before the device.
+        ~LvePipelineCache();
+
+        LvePipelineCache(const LvePipelineCache&) = delete;
+        LvePipelineCache &operator=(const LvePipelineCache&) = delete;
+
+        VkPipelineCache getCache() const { return cache; }
+
+        // Called by LvePipeline around every vkCreate*Pipelines; safe from any thread.
+        void recordCreation(double milliseconds);
+
+        // Writes the current cache contents to disk; returns false if that failed.
+        bool save() const;
+
+        Stats getStats() const;
+        void printStats(std::ostream &out) const;
+
+    private:
+        // nullptr if the cache data was made by this driver on this device, otherwise the reason not.
+        const char *checkHeader(const std::vector<char> &data) const;
+
+        VkDevice device;
+        VkPhysicalDeviceProperties properties;
+        std::string path;
+        VkPipelineCache cache = VK_NULL_HANDLE;
+        size_t loadedBytes = 0;
+        const char *loadResult = "";
+        std::atomic<uint32_t> pipelinesCreated{0};
+        std::atomic<uint64_t> creationNanoseconds{0};
+    };
+}
+
+#endif //VULKANTEST_LVE_PIPELINE_CACHE_HPP
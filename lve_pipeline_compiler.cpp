@@ -0,0 +1,154 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#include "lve_pipeline_compiler.hpp"
+
+// std
+#include <algorithm>
+#include <utility>
+
+namespace lve {
+
+    void LveAsyncPipeline::wait() const {
+        if (isReady()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock{mutex};
+        finished.wait(lock, [this] { return ready.load(std::memory_order_relaxed); });
+    }
+
+    LvePipeline *LveAsyncPipeline::get() const {
+        if (!isReady()) {
+            return fallback;
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return pipeline.get();
+    }
+
+    void LveAsyncPipeline::finish(std::unique_ptr<LvePipeline> result, std::exception_ptr failure) {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            pipeline = std::move(result);
+            error = std::move(failure);
+            ready.store(true, std::memory_order_release);
+        }
+        finished.notify_all();
+    }
+
+    LvePipelineCompiler::LvePipelineCompiler(LveDevice &device, uint32_t threadCount) : lveDevice{device} {
+        threadCount = std::max(threadCount, 1u);
+        stats.threads = threadCount;
+        workers.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++) {
+            workers.emplace_back(&LvePipelineCompiler::workerLoop, this);
+        }
+    }
+
+    LvePipelineCompiler::~LvePipelineCompiler() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        jobAvailable.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    uint32_t LvePipelineCompiler::defaultThreadCount() {
+        // Leave a core for the render thread, which keeps working while pipelines compile.
+        return std::clamp(std::thread::hardware_concurrency(), 2u, 5u) - 1;
+    }
+
+    std::shared_ptr<LveAsyncPipeline> LvePipelineCompiler::compileGraphics(
+            const std::string &vertFilepath, const std::string &fragFilepath,
+            std::unique_ptr<PipelineConfigInfo> configInfo, LvePipeline *fallback) {
+        std::shared_ptr<PipelineConfigInfo> config = std::move(configInfo);
+        return enqueue(fallback, [this, vertFilepath, fragFilepath, config] {
+            return std::make_unique<LvePipeline>(lveDevice, vertFilepath, fragFilepath, *config);
+        });
+    }
+
+    std::shared_ptr<LveAsyncPipeline> LvePipelineCompiler::compileCompute(
+            const std::string &compFilepath, VkPipelineLayout pipelineLayout, LvePipeline *fallback) {
+        return enqueue(fallback, [this, compFilepath, pipelineLayout] {
+            return std::make_unique<LvePipeline>(lveDevice, compFilepath, pipelineLayout);
+        });
+    }
+
+    std::shared_ptr<LveAsyncPipeline> LvePipelineCompiler::enqueue(
+            LvePipeline *fallback, std::function<std::unique_ptr<LvePipeline>()> build) {
+        std::shared_ptr<LveAsyncPipeline> target{new LveAsyncPipeline{fallback}};
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            jobs.push_back({target, std::move(build)});
+            pending++;
+            stats.requested++;
+        }
+        jobAvailable.notify_one();
+        return target;
+    }
+
+    void LvePipelineCompiler::workerLoop() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            auto start = std::chrono::high_resolution_clock::now();
+            std::unique_ptr<LvePipeline> pipeline;
+            std::exception_ptr failure;
+            try {
+                pipeline = job.build();
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            job.target->finish(std::move(pipeline), failure);
+
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                stats.compiled++;
+                stats.failed += failure ? 1 : 0;
+                stats.compileMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+                stats.lastReadyMilliseconds = std::chrono::duration<double, std::milli>(end - created).count();
+                pending--;
+                if (pending == 0) {
+                    idle.notify_all();
+                }
+            }
+        }
+    }
+
+    void LvePipelineCompiler::waitIdle() {
+        std::unique_lock<std::mutex> lock{mutex};
+        idle.wait(lock, [this] { return pending == 0; });
+    }
+
+    uint32_t LvePipelineCompiler::getPendingCount() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return pending;
+    }
+
+    LvePipelineCompiler::Stats LvePipelineCompiler::getStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return stats;
+    }
+
+    void LvePipelineCompiler::printStats(std::ostream &out) const {
+        Stats current = getStats();
+        out << "pipeline compiler: " << current.compiled << "/" << current.requested << " pipelines compiled ("
+            << current.failed << " failed) on " << current.threads << " threads, " << current.compileMilliseconds
+            << " ms of compiling, all ready " << current.lastReadyMilliseconds << " ms after start" << std::endl;
+    }
+}
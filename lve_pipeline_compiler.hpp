@@ -0,0 +1,118 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_PIPELINE_COMPILER_HPP
+#define VULKANTEST_LVE_PIPELINE_COMPILER_HPP
+
+#include "lve_pipeline.hpp"
+
+// std
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lve {
+
+    // A pipeline being built by LvePipelineCompiler. Until it is ready, get() hands out the fallback
+    // given with the request (which may be nullptr, meaning: skip what needs it).
+    class LveAsyncPipeline {
+    public:
+        LveAsyncPipeline(const LveAsyncPipeline&) = delete;
+        LveAsyncPipeline &operator=(const LveAsyncPipeline&) = delete;
+
+        bool isReady() const { return ready.load(std::memory_order_acquire); }
+        // Blocks until the compile has finished or failed; never throws.
+        void wait() const;
+        // The compiled pipeline when ready, else the fallback. Rethrows a failed compile.
+        LvePipeline *get() const;
+
+    private:
+        friend class LvePipelineCompiler;
+        explicit LveAsyncPipeline(LvePipeline *fallback) : fallback{fallback} {}
+
+        void finish(std::unique_ptr<LvePipeline> result, std::exception_ptr failure);
+
+        LvePipeline *fallback;
+        std::unique_ptr<LvePipeline> pipeline;
+        std::exception_ptr error;
+        std::atomic<bool> ready{false};
+        mutable std::mutex mutex;
+        mutable std::condition_variable finished;
+    };
+
+    // Builds pipelines on its own worker threads, all sharing the device's pipeline cache and shader
+    // modules, so startup doesn't wait on one vkCreate*Pipelines after the other. Startup is not
+    // free of waits, though: a pipeline nothing can stand in for (the shading and cull pipelines)
+    // is waited on by the first frame that needs it; only work that can be skipped (the depth
+    // prepass, the light billboards) is drawn without until its pipeline is ready. Must be
+    // destroyed before the device, and the layouts and render passes a request refers to must
+    // outlive its compile (wait() before destroying them).
+    class LvePipelineCompiler {
+    public:
+        struct Stats {
+            uint32_t threads = 0;
+            uint32_t requested = 0;
+            uint32_t compiled = 0;  // finished, successfully or not
+            uint32_t failed = 0;
+            double compileMilliseconds = 0.0;  // summed over all workers
+            double lastReadyMilliseconds = 0.0;  // from the compiler's creation to the last compile finishing
+        };
+
+        explicit LvePipelineCompiler(LveDevice &device, uint32_t threadCount = defaultThreadCount());
+        // Finishes the queued compiles first, so no handle is left waiting forever.
+        ~LvePipelineCompiler();
+
+        LvePipelineCompiler(const LvePipelineCompiler&) = delete;
+        LvePipelineCompiler &operator=(const LvePipelineCompiler&) = delete;
+
+        // The config is heap allocated because it points into itself and is read on a worker thread.
+        std::shared_ptr<LveAsyncPipeline> compileGraphics(
+                const std::string &vertFilepath, const std::string &fragFilepath,
+                std::unique_ptr<PipelineConfigInfo> configInfo, LvePipeline *fallback = nullptr);
+        std::shared_ptr<LveAsyncPipeline> compileCompute(
+                const std::string &compFilepath, VkPipelineLayout pipelineLayout, LvePipeline *fallback = nullptr);
+
+        // Blocks until every requested pipeline has finished compiling.
+        void waitIdle();
+        uint32_t getPendingCount() const;
+
+        Stats getStats() const;
+        void printStats(std::ostream &out) const;
+
+        static uint32_t defaultThreadCount();
+
+    private:
+        struct Job {
+            std::shared_ptr<LveAsyncPipeline> target;
+            std::function<std::unique_ptr<LvePipeline>()> build;
+        };
+
+        std::shared_ptr<LveAsyncPipeline> enqueue(LvePipeline *fallback, std::function<std::unique_ptr<LvePipeline>()> build);
+        void workerLoop();
+
+        LveDevice &lveDevice;
+        std::vector<std::thread> workers;
+        mutable std::mutex mutex;
+        std::condition_variable jobAvailable;
+        std::condition_variable idle;
+        std::deque<Job> jobs;
+        uint32_t pending = 0;  // queued or compiling
+        bool stopping = false;
+
+        std::chrono::high_resolution_clock::time_point created = std::chrono::high_resolution_clock::now();
+        Stats stats;
+    };
+}
+
+#endif //VULKANTEST_LVE_PIPELINE_COMPILER_HPP
@@ -0,0 +1,51 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+#include "lve_pipeline_statistics.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+    LvePipelineStatistics::LvePipelineStatistics(LveDevice &device) : lveDevice{device} {
+        assert(lveDevice.supportsPipelineStatistics() && "Pipeline statistics queries are not enabled");
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolInfo.queryCount = LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+        poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+        if (vkCreateQueryPool(lveDevice.device(), &poolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline statistics query pool!");
+        }
+    }
+
+    LvePipelineStatistics::~LvePipelineStatistics() {
+        vkDestroyQueryPool(lveDevice.device(), queryPool, nullptr);
+    }
+
+    void LvePipelineStatistics::begin(VkCommandBuffer commandBuffer, int frameIndex) {
+        uint32_t query = static_cast<uint32_t>(frameIndex);
+        // The frame that used this query last has finished, since its fence was waited on before
+        // this frame could begin.
+        if (queryUsed[query]) {
+            uint64_t result = 0;
+            if (vkGetQueryPoolResults(
+                    lveDevice.device(), queryPool, query, 1, sizeof(result), &result, sizeof(result),
+                    VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+                fragmentShaderInvocations = result;
+            }
+        }
+
+        vkCmdResetQueryPool(commandBuffer, queryPool, query, 1);
+        vkCmdBeginQuery(commandBuffer, queryPool, query, 0);
+    }
+
+    void LvePipelineStatistics::end(VkCommandBuffer commandBuffer, int frameIndex) {
+        uint32_t query = static_cast<uint32_t>(frameIndex);
+        vkCmdEndQuery(commandBuffer, queryPool, query);
+        queryUsed[query] = true;
+    }
+}
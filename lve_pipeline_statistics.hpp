@@ -0,0 +1,45 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_PIPELINE_STATISTICS_HPP
+#define VULKANTEST_LVE_PIPELINE_STATISTICS_HPP
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+
+namespace lve {
+
+    // Counts the fragment shader invocations of whole frames with a pipeline statistics query,
+    // to compare how much shading different render settings cost. Each frame in flight has its
+    // own query, read back when its frame index comes around again, so the count lags a couple
+    // of frames but never waits on the GPU. Needs LveDevice::supportsPipelineStatistics().
+    class LvePipelineStatistics {
+    public:
+        explicit LvePipelineStatistics(LveDevice &device);
+        ~LvePipelineStatistics();
+
+        LvePipelineStatistics(const LvePipelineStatistics&) = delete;
+        LvePipelineStatistics &operator=(const LvePipelineStatistics&) = delete;
+
+        // Both are recorded outside a render pass; everything in between is counted, secondary
+        // command buffers from LveRenderer included.
+        void begin(VkCommandBuffer commandBuffer, int frameIndex);
+        void end(VkCommandBuffer commandBuffer, int frameIndex);
+
+        // Of the most recent frame whose result was read back, or 0 before the first one.
+        uint64_t getFragmentShaderInvocations() const { return fragmentShaderInvocations; }
+
+    private:
+        LveDevice &lveDevice;
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        std::array<bool, LveSwapChain::MAX_FRAMES_IN_FLIGHT> queryUsed{};
+        uint64_t fragmentShaderInvocations = 0;
+    };
+}
+
+#endif //VULKANTEST_LVE_PIPELINE_STATISTICS_HPP
@@ -0,0 +1,217 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+#include "lve_render_queue.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace lve {
+
+    LveRenderQueue::Stats &LveRenderQueue::Stats::operator+=(const Stats &other) {
+        draws += other.draws;
+        pipelineBinds += other.pipelineBinds;
+        pipelineBindsSkipped += other.pipelineBindsSkipped;
+        descriptorBinds += other.descriptorBinds;
+        descriptorBindsSkipped += other.descriptorBindsSkipped;
+        modelBinds += other.modelBinds;
+        modelBindsSkipped += other.modelBindsSkipped;
+        return *this;
+    }
+
+    uint64_t LveRenderQueue::depthPrepassKey(uint32_t pipelineId, uint32_t modelId, float depth) {
+        return (static_cast<uint64_t>(Pass::DepthPrepass) << 62) |
+               (static_cast<uint64_t>(pipelineId & 0x3FF) << 52) |
+               (static_cast<uint64_t>(modelId & 0x3FFFF) << 24) |
+               depthBits(depth);
+    }
+
+    uint64_t LveRenderQueue::opaqueKey(uint32_t pipelineId, uint32_t materialId, uint32_t modelId, float depth) {
+        return (static_cast<uint64_t>(Pass::Opaque) << 62) |
+               (static_cast<uint64_t>(pipelineId & 0x3FF) << 52) |
+               (static_cast<uint64_t>(materialId & 0x3FF) << 42) |
+               (static_cast<uint64_t>(modelId & 0x3FFFF) << 24) |
+               depthBits(depth);
+    }
+
+    uint64_t LveRenderQueue::transparentKey(uint32_t pipelineId, float depth) {
+        return (static_cast<uint64_t>(Pass::Transparent) << 62) |
+               (static_cast<uint64_t>(0xFFFFFF - depthBits(depth)) << 38) |
+               (static_cast<uint64_t>(pipelineId & 0x3FF) << 28);
+    }
+
+    uint32_t LveRenderQueue::depthBits(float depth) {
+        // The bit pattern of a non-negative float grows with its value; keep the top 24 of 31 bits.
+        depth = std::max(depth, 0.f);
+        uint32_t bits;
+        memcpy(&bits, &depth, sizeof(bits));
+        return bits >> 7;
+    }
+
+    uint32_t LveRenderQueue::floatKey(float value) {
+        // Positive floats already order like their bits once the sign bit is set; negative ones
+        // order backwards, so all their bits are flipped.
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return (bits & 0x80000000u) != 0 ? ~bits : bits | 0x80000000u;
+    }
+
+    void LveRenderQueue::radixSort(std::vector<SortItem> &items, std::vector<SortItem> &scratch) {
+        if (scratch.size() < items.size()) {
+            scratch.resize(items.size());
+        }
+        radixSort(items.data(), scratch.data(), items.size());
+    }
+
+    void LveRenderQueue::radixSort(SortItem *items, SortItem *scratch, size_t count) {
+        if (count < 2) {
+            return;
+        }
+
+        SortItem *source = items;
+        SortItem *destination = scratch;
+        for (uint32_t shift = 0; shift < 64; shift += 8) {
+            std::array<uint32_t, 256> counts{};
+            for (size_t i = 0; i < count; i++) {
+                counts[(source[i].key >> shift) & 0xFF]++;
+            }
+            // Every key has the same digit, so this pass would not move anything.
+            if (counts[(source[0].key >> shift) & 0xFF] == count) {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for (auto &bucket : counts) {
+                uint32_t bucketSize = bucket;
+                bucket = offset;
+                offset += bucketSize;
+            }
+            for (size_t i = 0; i < count; i++) {
+                destination[counts[(source[i].key >> shift) & 0xFF]++] = source[i];
+            }
+            std::swap(source, destination);
+        }
+
+        if (source != items) {
+            std::copy(source, source + count, items);
+        }
+    }
+
+    void LveRenderQueue::clear() {
+        packets.clear();
+        order.clear();
+    }
+
+    void LveRenderQueue::submit(uint64_t key, const DrawPacket &packet) {
+        assert(packet.pipeline != nullptr && "Draw packet needs a pipeline");
+        assert(packet.pushConstantSize <= MAX_PUSH_CONSTANT_SIZE && "Push constants too large for a draw packet");
+        order.push_back({key, static_cast<uint32_t>(packets.size())});
+        packets.push_back(packet);
+    }
+
+    void LveRenderQueue::sort() {
+        radixSort(order, scratch);
+    }
+
+    void LveRenderQueue::execute(VkCommandBuffer commandBuffer, FrameInfo &frameInfo) {
+        stats = record(commandBuffer, frameInfo, 0, order.size());
+    }
+
+    const std::vector<VkCommandBuffer> &LveRenderQueue::executeParallel(
+            FrameInfo &frameInfo, LveRenderer &renderer, LveThreadPool &threadPool, uint32_t taskCount) {
+        size_t maxTasks = (order.size() + MIN_PACKETS_PER_TASK - 1) / MIN_PACKETS_PER_TASK;
+        taskCount = static_cast<uint32_t>(std::min<size_t>(
+                {taskCount, maxTasks, threadPool.getThreadCount(), renderer.getRecordingThreadCount()}));
+        taskCount = std::max(taskCount, 1u);
+
+        // Contiguous ranges keep the sorted order; each range starts with nothing bound.
+        secondaryCommandBuffers.resize(taskCount);
+        taskStats.assign(taskCount, Stats{});
+        size_t packetsPerTask = (order.size() + taskCount - 1) / taskCount;
+        threadPool.parallelFor(taskCount, [&](uint32_t taskIndex) {
+            size_t begin = std::min(order.size(), taskIndex * packetsPerTask);
+            size_t end = std::min(order.size(), begin + packetsPerTask);
+
+            VkCommandBuffer commandBuffer = renderer.beginSecondaryCommandBuffer(taskIndex);
+            taskStats[taskIndex] = record(commandBuffer, frameInfo, begin, end);
+            renderer.endSecondaryCommandBuffer(commandBuffer);
+            secondaryCommandBuffers[taskIndex] = commandBuffer;
+        });
+
+        stats = Stats{};
+        for (const auto &taskStat : taskStats) {
+            stats += taskStat;
+        }
+        return secondaryCommandBuffers;
+    }
+
+    LveRenderQueue::Stats LveRenderQueue::record(
+            VkCommandBuffer commandBuffer, FrameInfo &frameInfo, size_t begin, size_t end) const {
+        Stats recordStats{};
+        LvePipeline *boundPipeline = nullptr;
+        VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+        LveModel *boundModel = nullptr;
+
+        std::array<uint32_t, 5> dynamicOffsets{frameInfo.globalUboOffset, frameInfo.instanceDataOffset,
+                                               frameInfo.lightDataOffset, frameInfo.lightClusterOffset,
+                                               frameInfo.lightBillboardOffset};
+        for (size_t i = begin; i < end; i++) {
+            const DrawPacket &packet = packets[order[i].index];
+
+            if (packet.pipeline != boundPipeline) {
+                packet.pipeline->bind(commandBuffer);
+                boundPipeline = packet.pipeline;
+                recordStats.pipelineBinds++;
+            } else {
+                recordStats.pipelineBindsSkipped++;
+            }
+
+            // Layouts with different push constant ranges are not compatible, so set 0 is rebound.
+            if (packet.pipelineLayout != boundLayout) {
+                vkCmdBindDescriptorSets(
+                        commandBuffer,
+                        VK_PIPELINE_BIND_POINT_GRAPHICS,
+                        packet.pipelineLayout,
+                        0, 1,
+                        &frameInfo.globalDescriptorSet,
+                        static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+                boundLayout = packet.pipelineLayout;
+                recordStats.descriptorBinds++;
+            } else {
+                recordStats.descriptorBindsSkipped++;
+            }
+
+            if (packet.model != nullptr) {
+                if (packet.model != boundModel) {
+                    packet.model->bind(commandBuffer);
+                    boundModel = packet.model;
+                    recordStats.modelBinds++;
+                } else {
+                    recordStats.modelBindsSkipped++;
+                }
+            }
+
+            if (packet.pushConstantSize > 0) {
+                vkCmdPushConstants(
+                        commandBuffer,
+                        packet.pipelineLayout,
+                        packet.pushConstantStages,
+                        0,
+                        packet.pushConstantSize,
+                        packet.pushConstants.data());
+            }
+
+            if (packet.model == nullptr) {
+                vkCmdDraw(commandBuffer, packet.vertexCount, packet.instanceCount, 0, packet.firstInstance);
+            } else if (packet.indirectBuffer != VK_NULL_HANDLE) {
+                packet.model->drawIndirect(commandBuffer, packet.indirectBuffer, packet.indirectOffset);
+            } else {
+                packet.model->draw(commandBuffer, packet.instanceCount, packet.firstInstance);
+            }
+            recordStats.draws++;
+        }
+        return recordStats;
+    }
+}
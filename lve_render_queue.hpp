@@ -0,0 +1,116 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_RENDER_QUEUE_HPP
+#define VULKANTEST_LVE_RENDER_QUEUE_HPP
+
+#include "lve_frame_info.hpp"
+#include "lve_model.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_renderer.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+    // Per-frame list of draw packets that systems submit instead of recording directly. Packets
+    // carry a 64 bit sort key; after sort() they are recorded in key order, and binds that the
+    // previous packet already made are skipped.
+    //
+    // Key layout, most significant bits first:
+    //   depth prepass: pass(2) | pipeline(10) | unused(10) | model(18) | depth(24), front to back
+    //   opaque:        pass(2) | pipeline(10) | material(10) | model(18) | depth(24), front to back
+    //   transparent:   pass(2) | inverted depth(24) | pipeline(10) | unused(28), back to front
+    class LveRenderQueue {
+    public:
+        enum class Pass : uint64_t {
+            DepthPrepass = 0,
+            Opaque = 1,
+            Transparent = 2,
+        };
+
+        static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 64;
+
+        struct DrawPacket {
+            LvePipeline *pipeline = nullptr;
+            VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;  // global set 0 is bound with it
+            LveModel *model = nullptr;      // nullptr draws vertexCount vertices without vertex buffers
+            uint32_t vertexCount = 0;
+            uint32_t instanceCount = 1;
+            uint32_t firstInstance = 0;
+            VkBuffer indirectBuffer = VK_NULL_HANDLE;  // set to draw the model from an indirect command
+            VkDeviceSize indirectOffset = 0;
+            VkShaderStageFlags pushConstantStages = 0;
+            uint32_t pushConstantSize = 0;
+            std::array<uint8_t, MAX_PUSH_CONSTANT_SIZE> pushConstants{};
+        };
+
+        struct Stats {
+            uint32_t draws = 0;
+            uint32_t pipelineBinds = 0;
+            uint32_t pipelineBindsSkipped = 0;
+            uint32_t descriptorBinds = 0;
+            uint32_t descriptorBindsSkipped = 0;
+            uint32_t modelBinds = 0;
+            uint32_t modelBindsSkipped = 0;
+
+            Stats &operator+=(const Stats &other);
+        };
+
+        struct SortItem {
+            uint64_t key;
+            uint32_t index;
+        };
+
+        static uint64_t depthPrepassKey(uint32_t pipelineId, uint32_t modelId, float depth);
+        static uint64_t opaqueKey(uint32_t pipelineId, uint32_t materialId, uint32_t modelId, float depth);
+        static uint64_t transparentKey(uint32_t pipelineId, float depth);
+
+        // Monotonic 24 bit quantization of a non-negative depth or squared distance.
+        static uint32_t depthBits(float depth);
+        // The float's bits remapped so unsigned order matches float order, negative values included.
+        // Exact, so sorting by it keeps every distinct value apart; invert it to sort descending.
+        static uint32_t floatKey(float value);
+
+        // Stable LSD radix sort by key, 8 bits per pass, skipping passes where every key has the same
+        // digit, so 32 bit keys take at most four. Neither version allocates once scratch is large
+        // enough, so callers keep both arrays around between frames.
+        static void radixSort(std::vector<SortItem> &items, std::vector<SortItem> &scratch);
+        static void radixSort(SortItem *items, SortItem *scratch, size_t count);
+
+        void clear();
+        void submit(uint64_t key, const DrawPacket &packet);
+        void sort();
+
+        // Records all packets into a command buffer inside the swap chain render pass.
+        void execute(VkCommandBuffer commandBuffer, FrameInfo &frameInfo);
+
+        // Splits the sorted packets into up to taskCount contiguous ranges, each recorded into its own
+        // secondary command buffer on the thread pool. Returns the buffers in draw order.
+        const std::vector<VkCommandBuffer> &executeParallel(
+                FrameInfo &frameInfo, LveRenderer &renderer, LveThreadPool &threadPool, uint32_t taskCount);
+
+        size_t size() const { return packets.size(); }
+        const Stats &getStats() const { return stats; }
+
+    private:
+        // Below this many packets per task, the cost of another command buffer outweighs the gain.
+        static constexpr size_t MIN_PACKETS_PER_TASK = 64;
+
+        Stats record(VkCommandBuffer commandBuffer, FrameInfo &frameInfo, size_t begin, size_t end) const;
+
+        std::vector<DrawPacket> packets;
+        std::vector<SortItem> order;
+        std::vector<SortItem> scratch;
+        std::vector<Stats> taskStats;
+        std::vector<VkCommandBuffer> secondaryCommandBuffers;
+        Stats stats;
+    };
+}
+
+#endif //VULKANTEST_LVE_RENDER_QUEUE_HPP
@@ -9,13 +9,16 @@
 
 namespace lve {
 
-    LveRenderer::LveRenderer(LveWindow &window, LveDevice &device) : lveWindow{window}, lveDevice{device} {
+    LveRenderer::LveRenderer(LveWindow &window, LveDevice &device, uint32_t recordingThreadCount)
+            : lveWindow{window}, lveDevice{device}, recordingThreadCount{recordingThreadCount} {
         recreateSwapChain();
         recreateSwapChain();
         createCommandBuffers();
+        createSecondaryCommandPools();
     }
 
     LveRenderer::~LveRenderer() {
+        destroySecondaryCommandPools();
         freeCommandBuffers();
     }
 
@@ -58,6 +61,32 @@ namespace lve {
 
     }
 
+    void LveRenderer::createSecondaryCommandPools() {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = lveDevice.findPhysicalQueueFamilies().graphicsFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        secondaryCommandPools.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+        for (auto &framePools : secondaryCommandPools) {
+            framePools.resize(recordingThreadCount);
+            for (auto &pool : framePools) {
+                if (vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &pool.commandPool) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create secondary command pool!");
+                }
+            }
+        }
+    }
+
+    void LveRenderer::destroySecondaryCommandPools() {
+        for (auto &framePools : secondaryCommandPools) {
+            for (auto &pool : framePools) {
+                vkDestroyCommandPool(lveDevice.device(), pool.commandPool, nullptr);
+            }
+        }
+        secondaryCommandPools.clear();
+    }
+
     void LveRenderer::freeCommandBuffers() {
         vkFreeCommandBuffers(
                 lveDevice.device(),
@@ -81,6 +110,13 @@ namespace lve {
         }
 
         isFrameStarted = true;
+
+        // The frame's fence has signaled, so its secondary command buffers can be recycled.
+        for (auto &pool : secondaryCommandPools[currentFrameIndex]) {
+            vkResetCommandPool(lveDevice.device(), pool.commandPool, 0);
+            pool.used = 0;
+        }
+
         auto commandBuffer = getCurrentCommandBuffer();
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -88,6 +124,10 @@ namespace lve {
         if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
+
+        transferWaitSemaphores.clear();
+        transferWaitStages.clear();
+        lveDevice.acquirePendingTransfers(commandBuffer, transferWaitSemaphores, transferWaitStages);
         return commandBuffer;
     }
 
@@ -98,7 +138,9 @@ namespace lve {
             throw std::runtime_error("failed to record command buffer!");
         }
 
-        auto result = lveSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+        auto result = lveSwapChain->submitCommandBuffers(
+                &commandBuffer, &currentImageIndex, transferWaitSemaphores, transferWaitStages);
+        lveDevice.releaseAcquiredTransferSemaphores();
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || lveWindow.wasWindowResized()) {
             lveWindow.resetWindowResizedFlag();
             recreateSwapChain();
@@ -111,26 +153,45 @@ namespace lve {
 
     }
 
-    void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+    void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents, bool storeDepth) {
         assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
         assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame");
+        beginRenderPass(
+                commandBuffer, storeDepth ? lveSwapChain->getDepthStoreRenderPass() : lveSwapChain->getRenderPass(),
+                contents);
+    }
+
+    void LveRenderer::resumeSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents) {
+        assert(isFrameStarted && "Can't call resumeSwapChainRenderPass if frame is not in progress");
+        assert(commandBuffer == getCurrentCommandBuffer() && "Can't resume render pass on command buffer from a different frame");
+        beginRenderPass(commandBuffer, lveSwapChain->getLoadRenderPass(), contents);
+    }
 
+    void LveRenderer::beginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkSubpassContents contents) {
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = lveSwapChain->getRenderPass();
+        renderPassInfo.renderPass = renderPass;
         renderPassInfo.framebuffer = lveSwapChain->getFrameBuffer(currentImageIndex);
 
         renderPassInfo.renderArea.offset = {0, 0};
         renderPassInfo.renderArea.extent = lveSwapChain->getSwapChainExtent();
 
+        // Ignored by the load render pass.
         std::array<VkClearValue, 2> clearValues{};
         clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
         clearValues[1].depthStencil = {1.0f, 0};
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
 
+        // Secondary command buffers set their own dynamic state.
+        if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+            setViewportAndScissor(commandBuffer);
+        }
+    }
+
+    void LveRenderer::setViewportAndScissor(VkCommandBuffer commandBuffer) {
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
@@ -151,5 +212,66 @@ namespace lve {
 
     }
 
+    VkCommandBuffer LveRenderer::beginSecondaryCommandBuffer(uint32_t threadIndex) {
+        assert(isFrameStarted && "Can't call beginSecondaryCommandBuffer if frame is not in progress");
+        assert(threadIndex < recordingThreadCount && "Thread index out of range");
+
+        auto &pool = secondaryCommandPools[currentFrameIndex][threadIndex];
+        if (pool.used == pool.commandBuffers.size()) {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = pool.commandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer newCommandBuffer;
+            if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &newCommandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate secondary command buffer!");
+            }
+            pool.commandBuffers.push_back(newCommandBuffer);
+        }
+        VkCommandBuffer commandBuffer = pool.commandBuffers[pool.used++];
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = lveSwapChain->getRenderPass();
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = lveSwapChain->getFrameBuffer(currentImageIndex);
+        // Lets the secondaries run while LvePipelineStatistics counts the frame.
+        if (lveDevice.supportsPipelineStatistics()) {
+            inheritanceInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags =
+                VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording secondary command buffer!");
+        }
+        setViewportAndScissor(commandBuffer);
+        return commandBuffer;
+    }
+
+    void LveRenderer::endSecondaryCommandBuffer(VkCommandBuffer commandBuffer) {
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record secondary command buffer!");
+        }
+    }
+
+    void LveRenderer::executeSecondaryCommandBuffers(
+            VkCommandBuffer commandBuffer, const std::vector<VkCommandBuffer> &secondaryCommandBuffers) {
+        assert(commandBuffer == getCurrentCommandBuffer() && "Can't execute secondaries on command buffer from a different frame");
+        if (secondaryCommandBuffers.empty()) {
+            return;
+        }
+        vkCmdExecuteCommands(
+                commandBuffer,
+                static_cast<uint32_t>(secondaryCommandBuffers.size()),
+                secondaryCommandBuffers.data());
+    }
+
 }
 
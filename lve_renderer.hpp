@@ -17,7 +17,8 @@ namespace lve {
     class LveRenderer {
 
     public:
-        LveRenderer(LveWindow &window, LveDevice &device);
+        // recordingThreadCount is the number of threads that may record secondary command buffers.
+        LveRenderer(LveWindow &window, LveDevice &device, uint32_t recordingThreadCount = 1);
         ~LveRenderer();
 
         LveRenderer(const LveRenderer&) = delete;
@@ -25,6 +26,18 @@ namespace lve {
 
         VkRenderPass getSwapChainRenderPass() const { return lveSwapChain->getRenderPass(); }
         float getAspectRatio() const { return lveSwapChain->extentAspectRatio(); }
+        VkExtent2D getSwapChainExtent() const { return lveSwapChain->getSwapChainExtent(); }
+
+        // Depth attachment of the swap chain image being rendered to this frame.
+        VkImage getDepthImage() const {
+            assert(isFrameStarted && "Cannot get depth image when frame not in progress.");
+            return lveSwapChain->getDepthImage(static_cast<int>(currentImageIndex));
+        }
+        VkImageView getDepthImageView() const {
+            assert(isFrameStarted && "Cannot get depth image view when frame not in progress.");
+            return lveSwapChain->getDepthImageView(static_cast<int>(currentImageIndex));
+        }
+        VkFormat getDepthFormat() const { return lveSwapChain->getDepthFormat(); }
 
         bool isFrameInProgress() const { return isFrameStarted; }
 
@@ -40,18 +53,51 @@ namespace lve {
 
         VkCommandBuffer beginFrame();
         void endFrame();
-        void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+        // With storeDepth the depth buffer is kept after the pass, for compute work or a resumed pass.
+        void beginSwapChainRenderPass(
+                VkCommandBuffer commandBuffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE,
+                bool storeDepth = false);
         void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
+        // Begins the swap chain render pass again after endSwapChainRenderPass, keeping the color and
+        // depth drawn so far, e.g. after compute work that read the depth buffer.
+        void resumeSwapChainRenderPass(
+                VkCommandBuffer commandBuffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+
+        // Begins a secondary command buffer that continues the swap chain render pass, with the
+        // viewport and scissor already set. Buffers come from a command pool owned by threadIndex for
+        // the current frame, so threads with different indices can record at the same time.
+        VkCommandBuffer beginSecondaryCommandBuffer(uint32_t threadIndex);
+        void endSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+
+        // The render pass must have been begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+        void executeSecondaryCommandBuffers(
+                VkCommandBuffer commandBuffer, const std::vector<VkCommandBuffer> &secondaryCommandBuffers);
+
+        uint32_t getRecordingThreadCount() const { return recordingThreadCount; }
 
     private:
         void createCommandBuffers();
         void freeCommandBuffers();
         void recreateSwapChain();
+        void createSecondaryCommandPools();
+        void destroySecondaryCommandPools();
+        void setViewportAndScissor(VkCommandBuffer commandBuffer);
+        void beginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkSubpassContents contents);
+
+        struct SecondaryCommandPool {
+            VkCommandPool commandPool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> commandBuffers;
+            size_t used = 0;
+        };
 
         LveWindow& lveWindow;
         LveDevice& lveDevice;
         std::unique_ptr<LveSwapChain> lveSwapChain;
         std::vector<VkCommandBuffer> commandBuffers;
+        std::vector<VkSemaphore> transferWaitSemaphores;
+        std::vector<VkPipelineStageFlags> transferWaitStages;
+        uint32_t recordingThreadCount;
+        std::vector<std::vector<SecondaryCommandPool>> secondaryCommandPools; // [frame][thread]
 
         uint32_t currentImageIndex;
         int currentFrameIndex{0};
@@ -0,0 +1,123 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+#include "lve_scene_hierarchy.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace lve {
+
+    void LveSceneHierarchy::update(
+            LveGameObject::Map &gameObjects, std::vector<LveGameObject::id_t> &changed, LveTransformBatch *batch) {
+        bool rebuilt = false;
+        if (!built || gameObjects.size() != nodes.size() || structureVersion != LveGameObject::structureVersion) {
+            rebuild(gameObjects);
+            rebuilt = true;
+        }
+        if (batch != nullptr) {
+            buildLocalTransforms(*batch);
+        }
+
+        changed.clear();
+        for (size_t i = 0; i < nodes.size(); i++) {
+            LveGameObject &obj = *nodes[i];
+            uint32_t localVersion = obj.transform.getVersion();
+            int32_t parentIndex = parentIndices[i];
+            bool parentDirty = parentIndex != NO_PARENT_INDEX && dirty[parentIndex];
+
+            dirty[i] = rebuilt || parentDirty || localVersion != localVersions[i];
+            if (!dirty[i]) continue;
+
+            localVersions[i] = localVersion;
+            obj.worldMatrix = parentIndex == NO_PARENT_INDEX
+                    ? obj.transform.mat4()
+                    : nodes[parentIndex]->worldMatrix * obj.transform.mat4();
+            changed.push_back(obj.getId());
+        }
+    }
+
+    void LveSceneHierarchy::rebuild(LveGameObject::Map &gameObjects) {
+        // Depth of every object, walking up until a parent with a known depth or a root.
+        std::unordered_map<LveGameObject::id_t, uint32_t> depths;
+        depths.reserve(gameObjects.size());
+        std::vector<LveGameObject::id_t> chain;
+        uint32_t maxDepth = 0;
+        for (auto &gameObject : gameObjects) {
+            chain.clear();
+            LveGameObject::id_t id = gameObject.getId();
+            uint32_t firstDepth = 0;
+            while (true) {
+                auto known = depths.find(id);
+                if (known != depths.end()) {
+                    firstDepth = known->second + 1;
+                    break;
+                }
+                chain.push_back(id);
+                if (chain.size() > gameObjects.size()) {
+                    throw std::runtime_error("cycle in the scene hierarchy!");
+                }
+                const LveGameObject *parent = gameObjects.find(gameObjects.at(id).parentId);
+                if (parent == nullptr) {
+                    break;
+                }
+                id = parent->getId();
+            }
+            // chain runs from gameObject up to the topmost object without a known depth.
+            for (size_t i = chain.size(); i-- > 0;) {
+                depths[chain[i]] = firstDepth + static_cast<uint32_t>(chain.size() - 1 - i);
+            }
+            if (!chain.empty()) {
+                maxDepth = std::max(maxDepth, depths[chain.front()]);
+            }
+        }
+
+        // Counting sort by depth puts every parent before its children.
+        std::vector<uint32_t> depthStarts(maxDepth + 2, 0);
+        for (const auto &kv : depths) {
+            depthStarts[kv.second + 1]++;
+        }
+        for (size_t d = 1; d < depthStarts.size(); d++) {
+            depthStarts[d] += depthStarts[d - 1];
+        }
+        nodes.resize(gameObjects.size());
+        std::unordered_map<LveGameObject::id_t, int32_t> indices;
+        indices.reserve(gameObjects.size());
+        for (auto &gameObject : gameObjects) {
+            uint32_t index = depthStarts[depths[gameObject.getId()]]++;
+            nodes[index] = &gameObject;
+            indices[gameObject.getId()] = static_cast<int32_t>(index);
+        }
+
+        parentIndices.resize(nodes.size());
+        for (size_t i = 0; i < nodes.size(); i++) {
+            auto parent = indices.find(nodes[i]->parentId);
+            parentIndices[i] = parent == indices.end() ? NO_PARENT_INDEX : parent->second;
+        }
+        localVersions.assign(nodes.size(), 0);
+        dirty.assign(nodes.size(), 0);
+        structureVersion = LveGameObject::structureVersion;
+        built = true;
+    }
+
+    void LveSceneHierarchy::buildLocalTransforms(LveTransformBatch &batch) {
+        batch.clear();
+        for (const auto *node : nodes) {
+            if (node->transform.isStale()) {
+                const auto &transform = node->transform;
+                batch.add(transform.translation, transform.rotation, transform.scale);
+            }
+        }
+        batch.build();
+
+        size_t next = 0;
+        for (const auto *node : nodes) {
+            if (node->transform.isStale()) {
+                node->transform.store(batch.getModelMatrix(next), batch.getNormalMatrix(next));
+                next++;
+            }
+        }
+    }
+}
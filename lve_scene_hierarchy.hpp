@@ -0,0 +1,47 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_SCENE_HIERARCHY_HPP
+#define VULKANTEST_LVE_SCENE_HIERARCHY_HPP
+
+#include "lve_game_object.hpp"
+#include "lve_transform_batch.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+    // Flattened parent/child hierarchy of the game objects. The objects are kept in an array
+    // sorted so that every parent comes before its children, with the parent's index next to
+    // each entry, so all world matrices are computed in one linear pass. An object is only
+    // re-evaluated when its own transform or an ancestor's world matrix changed.
+    class LveSceneHierarchy {
+    public:
+        // Re-sorts if objects were added, removed or reparented since the last call, then
+        // refreshes the world matrices and lists the objects whose world matrix changed, so GPU
+        // copies of them can be updated incrementally. With a batch, the stale local transforms
+        // are first rebuilt together with SIMD.
+        void update(LveGameObject::Map &gameObjects, std::vector<LveGameObject::id_t> &changed,
+                    LveTransformBatch *batch = nullptr);
+
+        size_t size() const { return nodes.size(); }
+
+    private:
+        static constexpr int32_t NO_PARENT_INDEX = -1;
+
+        void rebuild(LveGameObject::Map &gameObjects);
+        void buildLocalTransforms(LveTransformBatch &batch);
+
+        std::vector<LveGameObject *> nodes;    // parents before children
+        std::vector<int32_t> parentIndices;    // index into nodes, or NO_PARENT_INDEX
+        std::vector<uint32_t> localVersions;   // transform version the world matrix was built from
+        std::vector<uint8_t> dirty;            // world matrix rebuilt in this update
+        uint32_t structureVersion = 0;
+        bool built = false;
+    };
+}
+
+#endif //VULKANTEST_LVE_SCENE_HIERARCHY_HPP
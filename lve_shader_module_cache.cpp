@@ -0,0 +1,125 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#include "lve_shader_module_cache.hpp"
+
+// std
+#include <fstream>
+#include <stdexcept>
+
+namespace lve {
+
+    LveShaderModuleCache::LveShaderModuleCache(VkDevice device) : device{device} {}
+
+    LveShaderModuleCache::~LveShaderModuleCache() {
+        for (auto &module : modules) {
+            vkDestroyShaderModule(device, module.module, nullptr);
+        }
+    }
+
+    std::vector<char> LveShaderModuleCache::readFile(const std::string &path) {
+        std::ifstream file{path, std::ios::ate | std::ios::binary};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + path);
+        }
+
+        size_t fileSize = static_cast<size_t>(file.tellg());
+        std::vector<char> buffer(fileSize);
+
+        file.seekg(0);
+        file.read(buffer.data(), static_cast<std::streamsize>(fileSize));
+        return buffer;
+    }
+
+    uint64_t LveShaderModuleCache::hash(const std::vector<char> &code) {
+        // 64 bit FNV-1a.
+        uint64_t value = 14695981039346656037ull;
+        for (char byte : code) {
+            value = (value ^ static_cast<uint8_t>(byte)) * 1099511628211ull;
+        }
+        return value;
+    }
+
+    size_t LveShaderModuleCache::findByHash(uint64_t codeHash, const std::vector<char> &code) const {
+        auto byHash = modulesByHash.find(codeHash);
+        if (byHash != modulesByHash.end() && modules[byHash->second].code == code) {
+            return byHash->second;
+        }
+        return NO_MODULE;
+    }
+
+    VkShaderModule LveShaderModuleCache::get(const std::string &path) {
+        std::unique_lock<std::mutex> lock{mutex};
+        stats.requests++;
+        while (true) {
+            auto byPath = modulesByPath.find(path);
+            if (byPath == modulesByPath.end()) {
+                break;
+            }
+            if (byPath->second != NO_MODULE) {
+                return modules[byPath->second].module;
+            }
+            loaded.wait(lock);
+        }
+        modulesByPath[path] = NO_MODULE;
+        lock.unlock();
+
+        // On failure the path is forgotten, so the waiters (and later requests) try it themselves.
+        auto abandon = [&] {
+            lock.lock();
+            modulesByPath.erase(path);
+            lock.unlock();
+            loaded.notify_all();
+        };
+
+        std::vector<char> code;
+        try {
+            code = readFile(path);
+        } catch (...) {
+            abandon();
+            throw;
+        }
+        const uint64_t codeHash = hash(code);
+
+        lock.lock();
+        stats.filesRead++;
+        size_t index = findByHash(codeHash, code);
+        if (index == NO_MODULE) {
+            lock.unlock();
+            VkShaderModuleCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            createInfo.codeSize = code.size();
+            createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+            VkShaderModule module;
+            if (vkCreateShaderModule(device, &createInfo, nullptr, &module) != VK_SUCCESS) {
+                abandon();
+                throw std::runtime_error("failed to create shader module!");
+            }
+
+            lock.lock();
+            // Another path with the same code may have been loaded meanwhile; keep the first module.
+            index = findByHash(codeHash, code);
+            if (index == NO_MODULE) {
+                stats.modulesCreated++;
+                index = modules.size();
+                modules.push_back({std::move(code), module});
+                // On a hash collision the first module keeps the hash entry; the new one is still found by path.
+                modulesByHash.emplace(codeHash, index);
+            } else {
+                vkDestroyShaderModule(device, module, nullptr);
+            }
+        }
+        modulesByPath[path] = index;
+        VkShaderModule module = modules[index].module;
+        lock.unlock();
+        loaded.notify_all();
+        return module;
+    }
+
+    LveShaderModuleCache::Stats LveShaderModuleCache::getStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return stats;
+    }
+}
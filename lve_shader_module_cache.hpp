@@ -0,0 +1,72 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_SHADER_MODULE_CACHE_HPP
+#define VULKANTEST_LVE_SHADER_MODULE_CACHE_HPP
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+
+    // Device wide shader modules, so pipelines sharing a shader (and their variants, e.g. with and
+    // without a depth prepass) read its SPIR-V file once and share one VkShaderModule. Files are
+    // also matched by a hash of their contents, so identical code under different paths shares a
+    // module too. Modules live until the cache is destroyed; safe to use from any thread. The lock
+    // only guards the lookups: files are read and modules created outside it, so compiler workers
+    // load different shaders at the same time, and a request for a path another thread is already
+    // loading waits for that load instead of repeating it.
+    class LveShaderModuleCache {
+    public:
+        struct Stats {
+            uint32_t filesRead = 0;
+            uint32_t modulesCreated = 0;
+            uint32_t requests = 0;  // get calls; all but modulesCreated of them reused a module
+        };
+
+        explicit LveShaderModuleCache(VkDevice device);
+        ~LveShaderModuleCache();
+
+        LveShaderModuleCache(const LveShaderModuleCache&) = delete;
+        LveShaderModuleCache &operator=(const LveShaderModuleCache&) = delete;
+
+        // Module for a SPIR-V file; throws if it can't be read or turned into a module, in which
+        // case a later request tries again.
+        VkShaderModule get(const std::string &path);
+
+        Stats getStats() const;
+
+    private:
+        struct Module {
+            std::vector<char> code;  // to tell hash collisions apart
+            VkShaderModule module;
+        };
+
+        // Not a modules index; modulesByPath maps a path whose load is in progress to it.
+        static constexpr size_t NO_MODULE = std::numeric_limits<size_t>::max();
+
+        static std::vector<char> readFile(const std::string &path);
+        static uint64_t hash(const std::vector<char> &code);
+        // Index of the module with exactly this code, or NO_MODULE.
+        size_t findByHash(uint64_t codeHash, const std::vector<char> &code) const;
+
+        VkDevice device;
+        mutable std::mutex mutex;
+        std::condition_variable loaded;  // a load finished or failed
+        std::vector<Module> modules;
+        std::unordered_map<std::string, size_t> modulesByPath;
+        std::unordered_map<uint64_t, size_t> modulesByHash;
+        Stats stats;
+    };
+}
+
+#endif //VULKANTEST_LVE_SHADER_MODULE_CACHE_HPP
@@ -0,0 +1,103 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_SPARSE_SET_HPP
+#define VULKANTEST_LVE_SPARSE_SET_HPP
+
+// std
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace lve {
+
+    // Values keyed by small integer ids. The values are packed in a dense array, so iterating
+    // touches only live entries in contiguous memory, and a sparse array indexed by id gives
+    // their position for O(1) lookup. Erasing moves the last value into the hole, so the order
+    // is not stable and references into the set are invalidated by emplace and erase. Emplacing
+    // an id that is already in the set throws; erasing one that is not does nothing.
+    template <typename T>
+    class LveSparseSet {
+    public:
+        using id_t = uint32_t;
+
+        T &emplace(id_t id, T &&value) {
+            if (contains(id)) throw std::invalid_argument("id is already in the sparse set!");
+            if (id >= sparse.size()) {
+                sparse.resize(static_cast<size_t>(id) + 1, INVALID_INDEX);
+            }
+            sparse[id] = static_cast<uint32_t>(dense.size());
+            denseIds.push_back(id);
+            dense.push_back(std::move(value));
+            return dense.back();
+        }
+
+        void erase(id_t id) {
+            if (!contains(id)) {
+                return;
+            }
+            uint32_t index = sparse[id];
+            if (index + 1 != dense.size()) {
+                id_t lastId = denseIds.back();
+                dense[index] = std::move(dense.back());
+                denseIds[index] = lastId;
+                sparse[lastId] = index;
+            }
+            dense.pop_back();
+            denseIds.pop_back();
+            sparse[id] = INVALID_INDEX;
+        }
+
+        void clear() {
+            dense.clear();
+            denseIds.clear();
+            sparse.clear();
+        }
+
+        bool contains(id_t id) const { return id < sparse.size() && sparse[id] != INVALID_INDEX; }
+
+        // Position of the id's value in the dense array, valid until the next erase.
+        uint32_t indexOf(id_t id) const {
+            assert(contains(id) && "Id is not in the set");
+            return sparse[id];
+        }
+        T &valueAt(uint32_t index) { return dense[index]; }
+        const T &valueAt(uint32_t index) const { return dense[index]; }
+
+        T *find(id_t id) { return contains(id) ? &dense[sparse[id]] : nullptr; }
+        const T *find(id_t id) const { return contains(id) ? &dense[sparse[id]] : nullptr; }
+
+        T &at(id_t id) {
+            if (!contains(id)) throw std::out_of_range("id is not in the sparse set!");
+            return dense[sparse[id]];
+        }
+        const T &at(id_t id) const {
+            if (!contains(id)) throw std::out_of_range("id is not in the sparse set!");
+            return dense[sparse[id]];
+        }
+
+        size_t size() const { return dense.size(); }
+        bool empty() const { return dense.empty(); }
+
+        // Dense ids, in the same order as the values.
+        const std::vector<id_t> &ids() const { return denseIds; }
+
+        typename std::vector<T>::iterator begin() { return dense.begin(); }
+        typename std::vector<T>::iterator end() { return dense.end(); }
+        typename std::vector<T>::const_iterator begin() const { return dense.begin(); }
+        typename std::vector<T>::const_iterator end() const { return dense.end(); }
+
+    private:
+        static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+        std::vector<T> dense;
+        std::vector<id_t> denseIds;
+        std::vector<uint32_t> sparse;
+    };
+}
+
+#endif //VULKANTEST_LVE_SPARSE_SET_HPP
@@ -25,8 +25,17 @@ class LveSwapChain {
   LveSwapChain &operator=(const LveSwapChain &) = delete;
 
   VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
+  // The depth is discarded at the end of the render pass.
   VkRenderPass getRenderPass() { return renderPass; }
+  // Compatible with getRenderPass, but stores the depth, so compute work can read it after the pass.
+  VkRenderPass getDepthStoreRenderPass() { return depthStoreRenderPass; }
+  // Compatible with getRenderPass, but loads the attachments instead of clearing them, so a frame
+  // can end the render pass, run compute work on its depth buffer and carry on drawing.
+  VkRenderPass getLoadRenderPass() { return loadRenderPass; }
   VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+  VkImage getDepthImage(int index) { return depthImages[index]; }
+  VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
+  VkFormat getDepthFormat() { return swapChainDepthFormat; }
   size_t imageCount() { return swapChainImages.size(); }
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
   VkExtent2D getSwapChainExtent() { return swapChainExtent; }
@@ -39,7 +48,11 @@ class LveSwapChain {
   VkFormat findDepthFormat();
 
   VkResult acquireNextImage(uint32_t *imageIndex);
-  VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+  VkResult submitCommandBuffers(
+      const VkCommandBuffer *buffers,
+      uint32_t *imageIndex,
+      const std::vector<VkSemaphore> &extraWaitSemaphores = {},
+      const std::vector<VkPipelineStageFlags> &extraWaitStages = {});
 
   bool compareSwapFormats(const LveSwapChain &swapChain) const {
     return swapChain.swapChainDepthFormat == swapChainDepthFormat &&
@@ -52,6 +65,7 @@ class LveSwapChain {
   void createImageViews();
   void createDepthResources();
   void createRenderPass();
+  VkRenderPass createRenderPass(bool clear, bool storeDepth);
   void createFramebuffers();
   void createSyncObjects();
 
@@ -68,6 +82,8 @@ class LveSwapChain {
 
   std::vector<VkFramebuffer> swapChainFramebuffers;
   VkRenderPass renderPass;
+  VkRenderPass depthStoreRenderPass;
+  VkRenderPass loadRenderPass;
 
   std::vector<VkImage> depthImages;
   std::vector<VkDeviceMemory> depthImageMemorys;
@@ -0,0 +1,107 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+#include "lve_thread_pool.hpp"
+
+// std
+#include <algorithm>
+#include <utility>
+
+namespace lve {
+
+    LveThreadPool::LveThreadPool(uint32_t threadCount) {
+        threadCount = std::max(threadCount, 1u);
+        workers.reserve(threadCount - 1);
+        for (uint32_t i = 1; i < threadCount; i++) {
+            workers.emplace_back(&LveThreadPool::workerLoop, this);
+        }
+    }
+
+    LveThreadPool::~LveThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    uint32_t LveThreadPool::defaultThreadCount() {
+        return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    void LveThreadPool::parallelFor(uint32_t taskCount, const std::function<void(uint32_t)> &task) {
+        if (taskCount == 0) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            currentTask = &task;
+            this->taskCount = taskCount;
+            nextTask = 0;
+            tasksRemaining = taskCount;
+            generation++;
+        }
+        workAvailable.notify_all();
+
+        runTasks();
+
+        std::unique_lock<std::mutex> lock{mutex};
+        workDone.wait(lock, [this] { return tasksRemaining == 0; });
+        currentTask = nullptr;
+        if (firstError) {
+            std::exception_ptr error = std::exchange(firstError, nullptr);
+            lock.unlock();
+            std::rethrow_exception(error);
+        }
+    }
+
+    void LveThreadPool::workerLoop() {
+        uint64_t seenGeneration = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                workAvailable.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+            }
+            runTasks();
+        }
+    }
+
+    void LveThreadPool::runTasks() {
+        while (true) {
+            const std::function<void(uint32_t)> *task;
+            uint32_t taskIndex;
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                if (currentTask == nullptr || nextTask >= taskCount) {
+                    return;
+                }
+                task = currentTask;
+                taskIndex = nextTask++;
+            }
+
+            // A throwing task still counts as done, so parallelFor never returns while others run.
+            std::exception_ptr error;
+            try {
+                (*task)(taskIndex);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock{mutex};
+            if (error && !firstError) {
+                firstError = error;
+            }
+            if (--tasksRemaining == 0) {
+                workDone.notify_one();
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_THREAD_POOL_HPP
+#define VULKANTEST_LVE_THREAD_POOL_HPP
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lve {
+
+    // Fixed set of worker threads for fork/join work such as recording command buffers. The thread
+    // calling parallelFor works on the tasks as well, so threadCount includes it.
+    class LveThreadPool {
+    public:
+        explicit LveThreadPool(uint32_t threadCount = defaultThreadCount());
+        ~LveThreadPool();
+
+        LveThreadPool(const LveThreadPool&) = delete;
+        LveThreadPool &operator=(const LveThreadPool&) = delete;
+
+        // Runs task(taskIndex) for every index in [0, taskCount) and returns once all have finished.
+        // Each index runs exactly once, so per-task resources can be indexed by it. If tasks throw,
+        // the first exception is rethrown once all of them have finished.
+        void parallelFor(uint32_t taskCount, const std::function<void(uint32_t)> &task);
+
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+        static uint32_t defaultThreadCount();
+
+    private:
+        void workerLoop();
+        void runTasks();
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable workDone;
+
+        const std::function<void(uint32_t)> *currentTask = nullptr;
+        uint32_t taskCount = 0;
+        uint32_t nextTask = 0;
+        uint32_t tasksRemaining = 0;
+        std::exception_ptr firstError;
+        uint64_t generation = 0;
+        bool stopping = false;
+    };
+}
+
+#endif //VULKANTEST_LVE_THREAD_POOL_HPP
@@ -0,0 +1,186 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+#include "lve_transform_batch.hpp"
+
+#if defined(__AVX__)
+#define LVE_TRANSFORM_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_TRANSFORM_SSE
+#include <emmintrin.h>
+#endif
+
+namespace lve {
+
+    namespace {
+
+#if defined(LVE_TRANSFORM_AVX)
+        struct Lanes {
+            using V = __m256;
+            static constexpr size_t WIDTH = 8;
+            static V load(const float *p) { return _mm256_loadu_ps(p); }
+            static void store(float *p, V v) { _mm256_storeu_ps(p, v); }
+            static V set1(float f) { return _mm256_set1_ps(f); }
+            static V add(V a, V b) { return _mm256_add_ps(a, b); }
+            static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+            static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+            static V div(V a, V b) { return _mm256_div_ps(a, b); }
+            static V round(V a) { return _mm256_cvtepi32_ps(_mm256_cvtps_epi32(a)); }
+            static V notEqual(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+            static V select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+            static V exclusiveOr(V a, V b) { return _mm256_xor_ps(a, b); }
+            static V negateIf(V mask, V a) { return _mm256_xor_ps(a, _mm256_and_ps(mask, _mm256_set1_ps(-0.0f))); }
+        };
+#elif defined(LVE_TRANSFORM_SSE)
+        struct Lanes {
+            using V = __m128;
+            static constexpr size_t WIDTH = 4;
+            static V load(const float *p) { return _mm_loadu_ps(p); }
+            static void store(float *p, V v) { _mm_storeu_ps(p, v); }
+            static V set1(float f) { return _mm_set1_ps(f); }
+            static V add(V a, V b) { return _mm_add_ps(a, b); }
+            static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+            static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+            static V div(V a, V b) { return _mm_div_ps(a, b); }
+            static V round(V a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+            static V notEqual(V a, V b) { return _mm_cmpneq_ps(a, b); }
+            static V select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+            static V exclusiveOr(V a, V b) { return _mm_xor_ps(a, b); }
+            static V negateIf(V mask, V a) { return _mm_xor_ps(a, _mm_and_ps(mask, _mm_set1_ps(-0.0f))); }
+        };
+#endif
+
+#if defined(LVE_TRANSFORM_AVX) || defined(LVE_TRANSFORM_SSE)
+        // Sine and cosine of every lane. The angle is reduced by the nearest multiple j of pi/2 (in
+        // three parts, to keep the error small), both polynomials are evaluated on [-pi/4, pi/4],
+        // and j mod 4 swaps and negates them. Accurate to a few float ulps for the angles a
+        // scene uses; inputs past about 1e5 radians lose precision.
+        void sinCos(Lanes::V x, Lanes::V &sine, Lanes::V &cosine) {
+            using L = Lanes;
+            L::V j = L::round(L::mul(x, L::set1(0.63661977236758134f)));  // 2 / pi
+            L::V r = L::sub(x, L::mul(j, L::set1(1.5703125f)));
+            r = L::sub(r, L::mul(j, L::set1(4.837512969970703125e-4f)));
+            r = L::sub(r, L::mul(j, L::set1(7.54978995489188216e-8f)));
+            L::V z = L::mul(r, r);
+
+            L::V s = L::add(L::mul(z, L::set1(-1.9515295891e-4f)), L::set1(8.3321608736e-3f));
+            s = L::add(L::mul(s, z), L::set1(-1.6666654611e-1f));
+            s = L::add(L::mul(L::mul(s, z), r), r);
+
+            L::V c = L::add(L::mul(z, L::set1(2.443315711809948e-5f)), L::set1(-1.388731625493765e-3f));
+            c = L::add(L::mul(c, z), L::set1(4.166664568298827e-2f));
+            c = L::add(L::sub(L::mul(L::mul(c, z), z), L::mul(z, L::set1(0.5f))), L::set1(1.0f));
+
+            // j odd swaps sine and cosine; bit 1 of j negates the sine, and bit 0 xor bit 1 the cosine.
+            L::V halfJ = L::mul(j, L::set1(0.5f));
+            L::V jOdd = L::notEqual(halfJ, L::round(halfJ));
+            L::V k = L::round(L::sub(halfJ, L::set1(0.25f)));  // floor(j / 2)
+            L::V halfK = L::mul(k, L::set1(0.5f));
+            L::V kOdd = L::notEqual(halfK, L::round(halfK));
+
+            sine = L::negateIf(kOdd, L::select(jOdd, c, s));
+            cosine = L::negateIf(L::exclusiveOr(jOdd, kOdd), L::select(jOdd, s, c));
+        }
+#endif
+    }
+
+    void LveTransformBatch::clear() {
+        translationX.clear();
+        translationY.clear();
+        translationZ.clear();
+        rotationX.clear();
+        rotationY.clear();
+        rotationZ.clear();
+        scaleX.clear();
+        scaleY.clear();
+        scaleZ.clear();
+    }
+
+    void LveTransformBatch::add(const glm::vec3 &translation, const glm::vec3 &rotation, const glm::vec3 &scale) {
+        translationX.push_back(translation.x);
+        translationY.push_back(translation.y);
+        translationZ.push_back(translation.z);
+        rotationX.push_back(rotation.x);
+        rotationY.push_back(rotation.y);
+        rotationZ.push_back(rotation.z);
+        scaleX.push_back(scale.x);
+        scaleY.push_back(scale.y);
+        scaleZ.push_back(scale.z);
+    }
+
+    void LveTransformBatch::build() {
+        size_t count = size();
+        modelMatrices.resize(count);
+        normalMatrices.resize(count);
+        size_t i = 0;
+
+#if defined(LVE_TRANSFORM_AVX) || defined(LVE_TRANSFORM_SSE)
+        using L = Lanes;
+        // Model columns 0-2 (xyz), then normal columns 0-2 (xyz), one lane per transform.
+        alignas(32) float results[18][L::WIDTH];
+        for (; i + L::WIDTH <= count; i += L::WIDTH) {
+            L::V s1, c1, s2, c2, s3, c3;
+            sinCos(L::load(&rotationX[i]), s1, c1);
+            sinCos(L::load(&rotationY[i]), s2, c2);
+            sinCos(L::load(&rotationZ[i]), s3, c3);
+
+            L::V s1s2 = L::mul(s1, s2);
+            L::V c1s2 = L::mul(c1, s2);
+            L::V rotation[3][3] = {
+                    {L::add(L::mul(c1, c3), L::mul(s1s2, s3)), L::mul(c2, s3), L::sub(L::mul(c1s2, s3), L::mul(c3, s1))},
+                    {L::sub(L::mul(c3, s1s2), L::mul(c1, s3)), L::mul(c2, c3), L::add(L::mul(c1s2, c3), L::mul(s1, s3))},
+                    {L::mul(c2, s1), L::sub(L::set1(0.0f), s2), L::mul(c1, c2)}};
+
+            L::V scale[3] = {L::load(&scaleX[i]), L::load(&scaleY[i]), L::load(&scaleZ[i])};
+            for (int column = 0; column < 3; column++) {
+                L::V invScale = L::div(L::set1(1.0f), scale[column]);
+                for (int row = 0; row < 3; row++) {
+                    L::store(results[column * 3 + row], L::mul(scale[column], rotation[column][row]));
+                    L::store(results[9 + column * 3 + row], L::mul(invScale, rotation[column][row]));
+                }
+            }
+
+            for (size_t lane = 0; lane < L::WIDTH; lane++) {
+                glm::mat4 &model = modelMatrices[i + lane];
+                glm::mat4 &normal = normalMatrices[i + lane];
+                for (int column = 0; column < 3; column++) {
+                    model[column] = {results[column * 3][lane], results[column * 3 + 1][lane],
+                                     results[column * 3 + 2][lane], 0.0f};
+                    normal[column] = {results[9 + column * 3][lane], results[9 + column * 3 + 1][lane],
+                                      results[9 + column * 3 + 2][lane], 0.0f};
+                }
+                model[3] = {translationX[i + lane], translationY[i + lane], translationZ[i + lane], 1.0f};
+                normal[3] = {0.0f, 0.0f, 0.0f, 1.0f};
+            }
+        }
+#endif
+
+        buildRange(i, count);
+    }
+
+    void LveTransformBatch::buildRange(size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const float c3 = glm::cos(rotationZ[i]);
+            const float s3 = glm::sin(rotationZ[i]);
+            const float c2 = glm::cos(rotationY[i]);
+            const float s2 = glm::sin(rotationY[i]);
+            const float c1 = glm::cos(rotationX[i]);
+            const float s1 = glm::sin(rotationX[i]);
+            const glm::vec3 rotationColumns[3] = {
+                    {(c1 * c3 + s1 * s2 * s3), (c2 * s3), (c1 * s2 * s3 - c3 * s1)},
+                    {(c3 * s1 * s2 - c1 * s3), (c2 * c3), (c1 * c3 * s2 + s1 * s3)},
+                    {(c2 * s1), (-s2), (c1 * c2)}};
+            const glm::vec3 scale{scaleX[i], scaleY[i], scaleZ[i]};
+
+            glm::mat4 &model = modelMatrices[i];
+            glm::mat4 &normal = normalMatrices[i];
+            for (int column = 0; column < 3; column++) {
+                model[column] = glm::vec4(scale[column] * rotationColumns[column], 0.0f);
+                normal[column] = glm::vec4(rotationColumns[column] / scale[column], 0.0f);
+            }
+            model[3] = {translationX[i], translationY[i], translationZ[i], 1.0f};
+            normal[3] = {0.0f, 0.0f, 0.0f, 1.0f};
+        }
+    }
+}
@@ -0,0 +1,53 @@
+//
+// Created by cdgira on 10/19/2023.
+//
+
+#ifndef VULKANTEST_LVE_TRANSFORM_BATCH_HPP
+#define VULKANTEST_LVE_TRANSFORM_BATCH_HPP
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cstddef>
+#include <vector>
+
+namespace lve {
+
+    // Builds many transforms at once. Translation, rotation and scale are kept as structure of
+    // arrays, and build() evaluates the same YXZ Tait-Bryan composition as
+    // TransformComponent::mat4() and normalMatrix() for 8 transforms at a time with AVX or 4 with
+    // SSE, using a polynomial sine and cosine. The remainder, and other targets, take the scalar
+    // loop.
+    class LveTransformBatch {
+    public:
+        void clear();
+        void add(const glm::vec3 &translation, const glm::vec3 &rotation, const glm::vec3 &scale);
+
+        // Fills the model and normal matrix of every added transform, in add order.
+        void build();
+
+        const glm::mat4 &getModelMatrix(size_t i) const { return modelMatrices[i]; }
+        const glm::mat4 &getNormalMatrix(size_t i) const { return normalMatrices[i]; }
+        size_t size() const { return translationX.size(); }
+
+    private:
+        void buildRange(size_t begin, size_t end);
+
+        std::vector<float> translationX;
+        std::vector<float> translationY;
+        std::vector<float> translationZ;
+        std::vector<float> rotationX;
+        std::vector<float> rotationY;
+        std::vector<float> rotationZ;
+        std::vector<float> scaleX;
+        std::vector<float> scaleY;
+        std::vector<float> scaleZ;
+
+        std::vector<glm::mat4> modelMatrices;
+        std::vector<glm::mat4> normalMatrices;
+    };
+}
+
+#endif //VULKANTEST_LVE_TRANSFORM_BATCH_HPP
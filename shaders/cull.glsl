@@ -0,0 +1,82 @@
+// Declarations shared by cull.comp and cull_late.comp, which run over the same object records,
+// one per game object id.
+
+// Must match InstanceData in simple_shader.vert.
+struct InstanceData {
+    vec4 modelRows[3];
+    vec3 inverseScaleSquared;
+    int textureId;
+    uvec4 lights;
+};
+
+struct ObjectData {
+    InstanceData instance;
+    vec4 boundingSphere;  // model space, w is the radius
+    uint drawIndex;       // which indirect draw command (one per model), NO_DRAW for an empty id
+    uint padding[3];
+};
+
+layout (std430, set = 0, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
+
+layout (std430, set = 0, binding = 1) writeonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceBuffer;
+
+// VkDrawIndexedIndirectCommand (or VkDrawIndirectCommand) per model, 5 uints apart.
+layout (std430, set = 0, binding = 2) buffer DrawCommandBuffer {
+    uint drawCommands[];
+} drawCommandBuffer;
+
+layout (std430, set = 0, binding = 3) readonly buffer CullBuffer {
+    mat4 view;
+    vec4 frustumPlanes[6];
+    vec4 projection;      // projection matrix [0][0], [1][1], [2][2] and [3][2]
+    uint objectCount;
+    uint occlusionCulling;
+    uint lateInstanceBase;  // where cull_late.comp's instances start
+} cullData;
+
+// Per game object id: 1 if it passed the occlusion test last frame. Persists across frames.
+layout (std430, set = 0, binding = 4) buffer VisibilityBuffer {
+    uint visibility[];
+} visibilityBuffer;
+
+// First instance slot of each draw command.
+layout (std430, set = 0, binding = 5) readonly buffer DrawGroupBuffer {
+    uint firstInstances[];
+} drawGroupBuffer;
+
+const uint NO_DRAW = 0xffffffffu;
+const uint DRAW_COMMAND_STRIDE = 5;
+const uint INSTANCE_COUNT_OFFSET = 1;
+
+void worldSphere(ObjectData object, out vec3 center, out float radius) {
+    vec4 sphereCenter = vec4(object.boundingSphere.xyz, 1.0);
+    center = vec3(
+        dot(object.instance.modelRows[0], sphereCenter),
+        dot(object.instance.modelRows[1], sphereCenter),
+        dot(object.instance.modelRows[2], sphereCenter));
+    vec3 inverseScaleSquared = object.instance.inverseScaleSquared;
+    float minInverseScaleSquared = min(inverseScaleSquared.x, min(inverseScaleSquared.y, inverseScaleSquared.z));
+    radius = object.boundingSphere.w * inversesqrt(minInverseScaleSquared);
+}
+
+bool inFrustum(vec3 center, float radius) {
+    for (int i = 0; i < 6; i++) {
+        if (dot(cullData.frustumPlanes[i].xyz, center) + cullData.frustumPlanes[i].w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Counts the object into its model's draw command and writes its instance, with the draw's
+// instances starting at instanceBase plus the draw's first instance.
+void emitInstance(ObjectData object, uint instanceBase) {
+    uint slot = atomicAdd(
+        drawCommandBuffer.drawCommands[object.drawIndex * DRAW_COMMAND_STRIDE + INSTANCE_COUNT_OFFSET], 1);
+    uint firstInstance = drawGroupBuffer.firstInstances[object.drawIndex];
+    instanceBuffer.instances[instanceBase + firstInstance + slot] = object.instance;
+}
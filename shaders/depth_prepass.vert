@@ -0,0 +1,40 @@
+#version 450
+
+// Position only version of simple_shader.vert for the depth prepass. The main pass then tests
+// its depth for EQUAL against what this wrote, so gl_Position has to come out bit for bit the
+// same: it is declared invariant in both, and computed with the same expression.
+
+layout (location = 0) in vec3 position;
+
+layout (set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection;
+    mat4 view;
+    mat4 invView;
+    vec4 ambientLightColor;
+    uvec4 clusterCounts; // tiles in x and y, depth slices, number of lights
+    vec4 clusterParams; // pixels per tile in x and y, log(view depth) to slice scale and bias
+} ubo;
+
+struct InstanceData {
+    vec4 modelRows[3];
+    vec3 inverseScaleSquared;
+    int textureId;
+    uvec4 lights;
+};
+
+layout (std430, set = 0, binding = 6) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceBuffer;
+
+invariant gl_Position;
+
+void main() {
+    InstanceData instance = instanceBuffer.instances[gl_InstanceIndex];
+    vec4 positionModel = vec4(position, 1.0);
+    vec4 positionWorld = vec4(
+        dot(instance.modelRows[0], positionModel),
+        dot(instance.modelRows[1], positionModel),
+        dot(instance.modelRows[2], positionModel),
+        1.0);
+    gl_Position = ubo.projection * ubo.view * positionWorld;
+}
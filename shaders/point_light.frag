@@ -1,28 +1,18 @@
 #version 450
 
 layout (location = 0) in vec2 fragOffset;
+layout (location = 1) flat in vec4 fragColor;
 layout (location = 0) out vec4 outColor;
 
-struct PointLight {
-    vec4 position; // ignore w
-    vec4 color; // w is intensity
-};
-
 layout (set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
     mat4 invView;
     vec4 ambientLightColor;
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterCounts; // tiles in x and y, depth slices, number of lights
+    vec4 clusterParams; // pixels per tile in x and y, log(view depth) to slice scale and bias
 } ubo;
 
-layout(push_constant) uniform Push {
-    vec4 position;
-    vec4 color;
-    float radius;
-} push;
-
 const float PI = 3.1415926535;
 
 void main() {
@@ -30,5 +20,5 @@ void main() {
     if (dist > 1.0) {
         discard;
     }
-    outColor = vec4(push.color.xyz, 0.0);//0.5 * (cos(dist * PI) + 1.0));
+    outColor = vec4(fragColor.xyz, 0.0);//0.5 * (cos(dist * PI) + 1.0));
 }
\ No newline at end of file
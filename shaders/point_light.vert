@@ -10,35 +10,37 @@ const vec2 OFFSETS[6] = vec2[](
 );
 
 layout(location = 0) out vec2 fragOffset;
-
-struct PointLight {
-    vec4 position; // ignore w
-    vec4 color; // w is intensity
-};
+layout(location = 1) flat out vec4 fragColor;
 
 layout (set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
     mat4 invView;
     vec4 ambientLightColor;
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterCounts; // tiles in x and y, depth slices, number of lights
+    vec4 clusterParams; // pixels per tile in x and y, log(view depth) to slice scale and bias
 } ubo;
 
-layout(push_constant) uniform Push {
-    vec4 position;
-    vec4 color;
-    float radius;
-} push;
+// Written back to front by PointLightSystem::submit, one per instance.
+struct LightBillboard {
+    vec4 position; // w is radius
+    vec4 color; // w is intensity
+};
+
+layout (std430, set = 0, binding = 9) readonly buffer LightBillboardBuffer {
+    LightBillboard billboards[];
+} billboardBuffer;
 
 void main() {
+    LightBillboard billboard = billboardBuffer.billboards[gl_InstanceIndex];
     fragOffset = OFFSETS[gl_VertexIndex];
+    fragColor = billboard.color;
     vec3 cameraRightWorld = {ubo.view[0][0], ubo.view[1][0], ubo.view[2][0]};
     vec3 cameraUpWorld = {ubo.view[0][1], ubo.view[1][1], ubo.view[2][1]};
 
-    vec3 positionWorld = push.position.xyz
-      + push.radius *fragOffset.x * cameraRightWorld
-      + push.radius *fragOffset.y * cameraUpWorld;
+    vec3 positionWorld = billboard.position.xyz
+      + billboard.position.w *fragOffset.x * cameraRightWorld
+      + billboard.position.w *fragOffset.y * cameraUpWorld;
 
     gl_Position = ubo.projection * ubo.view * vec4(positionWorld, 1.0);
 }
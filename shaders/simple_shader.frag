@@ -4,11 +4,16 @@ layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec3 positionWorld;
 layout(location = 2) in vec3 normalWorldSpace;
 layout(location = 3) in vec2 fragTexCoord; // texture coordinates
+layout(location = 4) flat in int fragTextureId;
+layout(location = 5) flat in uvec4 fragLights; // object light list, see MAX_OBJECT_LIGHTS
+
+const uint NO_LIGHT = 0xffffffffu;
+const uint CLUSTERED_LIGHTS = 0xfffffffeu;
 
 layout(location = 0) out vec4 outColor;
 
 struct PointLight {
-    vec4 position; // ignore w
+    vec4 position; // w is range
     vec4 color; // w is intensity
 };
 
@@ -17,8 +22,8 @@ layout (set = 0, binding = 0) uniform GlobalUbo {
     mat4 view;
     mat4 invView;
     vec4 ambientLightColor;
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterCounts; // tiles in x and y, depth slices, number of lights
+    vec4 clusterParams; // pixels per tile in x and y, log(view depth) to slice scale and bias
 } ubo;
 
 layout (set = 0, binding = 1) uniform sampler2D textSampler;
@@ -27,10 +32,48 @@ layout (set = 0, binding = 3) uniform sampler2D textSampler3;
 layout (set = 0, binding = 4) uniform sampler2D textSampler4;
 layout (set = 0, binding = 5) uniform sampler2D textSampler5;
 
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix; //[3][3] is the Texture Binding
-} push;
+layout (std430, set = 0, binding = 7) readonly buffer LightBuffer {
+    PointLight lights[];
+} lightBuffer;
+
+// Built by LveLightClusters: an (index of the first light index, light count) pair per cluster,
+// followed by the light indices of all clusters.
+layout (std430, set = 0, binding = 8) readonly buffer ClusterBuffer {
+    uint values[];
+} clusterBuffer;
+
+uint clusterIndex(vec3 positionWorld)
+{
+    float viewDepth = (ubo.view * vec4(positionWorld, 1.0)).z;
+    uvec3 cluster = uvec3(
+        gl_FragCoord.xy / ubo.clusterParams.xy,
+        max(log(viewDepth) * ubo.clusterParams.z + ubo.clusterParams.w, 0.0));
+    cluster = min(cluster, ubo.clusterCounts.xyz - 1u);
+    return (cluster.z * ubo.clusterCounts.y + cluster.y) * ubo.clusterCounts.x + cluster.x;
+}
+
+void addLight(uint lightIndex, vec3 surfaceNormal, vec3 viewDir, inout vec3 diffuseLight, inout vec3 specularLight)
+{
+    PointLight light = lightBuffer.lights[lightIndex];
+    vec3 directionToLight = light.position.xyz - positionWorld;
+    float distanceSquared = dot(directionToLight,directionToLight);
+    // Inverse square falloff, windowed to reach zero at the light's range.
+    float window = clamp(1.0 - pow(distanceSquared / (light.position.w * light.position.w), 2.0), 0.0, 1.0);
+    float attenuation = window * window / distanceSquared;
+    directionToLight = normalize(directionToLight);
+
+    float cosAngIncidence = max(dot(surfaceNormal,directionToLight),0);
+    vec3 intensity = light.color.xyz * light.color.w * attenuation;
+
+    diffuseLight += intensity * cosAngIncidence;
+
+    // Specular Lighting
+    vec3 halfAngle = normalize(directionToLight + viewDir);
+    float blinnTerm = dot(surfaceNormal,halfAngle);
+    blinnTerm = clamp(blinnTerm,0,1);
+    blinnTerm = pow(blinnTerm,100.0); // shininess - higher is more shiny
+    specularLight += blinnTerm * intensity;
+}
 
 void main()
 {
@@ -41,26 +84,20 @@ void main()
     vec3 cameraPosWorld = ubo.invView[3].xyz;
     vec3 viewDir = normalize(cameraPosWorld - positionWorld);
 
-    for (int i=0;i<ubo.numLights;i++) {
-        PointLight light = ubo.pointLights[i];
-        vec3 directionToLight = light.position.xyz - positionWorld;
-        float attenuation = 1.0/dot(directionToLight,directionToLight);
-        directionToLight = normalize(directionToLight);
-
-        float cosAngIncidence = max(dot(surfaceNormal,directionToLight),0);
-        vec3 intensity = light.color.xyz * light.color.w * attenuation;
-
-        diffuseLight += intensity * cosAngIncidence;
-
-        // Specular Lighting
-        vec3 halfAngle = normalize(directionToLight + viewDir);
-        float blinnTerm = dot(surfaceNormal,halfAngle);
-        blinnTerm = clamp(blinnTerm,0,1);
-        blinnTerm = pow(blinnTerm,100.0); // shininess - higher is more shiny
-        specularLight += blinnTerm * intensity;
+    if (fragLights.x == CLUSTERED_LIGHTS) {
+        uint cluster = clusterIndex(positionWorld);
+        uint firstLight = clusterBuffer.values[2 * cluster];
+        uint lightCount = clusterBuffer.values[2 * cluster + 1];
+        for (uint i=0;i<lightCount;i++) {
+            addLight(clusterBuffer.values[firstLight + i], surfaceNormal, viewDir, diffuseLight, specularLight);
+        }
+    } else {
+        // The same list for the whole object, so the loop rarely diverges.
+        for (int i=0;i<4 && fragLights[i] != NO_LIGHT;i++) {
+            addLight(fragLights[i], surfaceNormal, viewDir, diffuseLight, specularLight);
+        }
     }
 
-    int fragTextureId = int(round(push.normalMatrix[3][3]));
     vec4 tFragColor = vec4(fragColor,1.0);
     if (fragTextureId == 1)
         tFragColor = texture(textSampler,fragTexCoord);//fragTexCoord is 2D
@@ -9,33 +9,54 @@ layout (location = 0) out vec3 fragColor;
 layout (location = 1) out vec3 fragPosWorld;
 layout (location = 2) out vec3 fragNormalWorld;
 layout (location = 3) out vec2 fragTexCoord;
-
-struct PointLight {
-    vec4 position; // ignore w
-    vec4 color; // w is intensity
-};
+layout (location = 4) flat out int fragTextureId;
+layout (location = 5) flat out uvec4 fragLights;
 
 layout (set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
     mat4 invView;
     vec4 ambientLightColor;
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterCounts; // tiles in x and y, depth slices, number of lights
+    vec4 clusterParams; // pixels per tile in x and y, log(view depth) to slice scale and bias
 } ubo;
 
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;  //[3][3] is the Texture Binding
-} push;
+// Top three rows of the model matrix, and the inverse squared scale that turns its upper 3x3
+// into the normal matrix, and the object's light list.
+struct InstanceData {
+    vec4 modelRows[3];
+    vec3 inverseScaleSquared;
+    int textureId;
+    uvec4 lights;
+};
+
+layout (std430, set = 0, binding = 6) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceBuffer;
+
+// Matches depth_prepass.vert exactly, so the EQUAL depth test after a prepass passes.
+invariant gl_Position;
 
 void main() {
-    vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+    // gl_InstanceIndex already includes the draw's firstInstance.
+    InstanceData instance = instanceBuffer.instances[gl_InstanceIndex];
+    vec4 positionModel = vec4(position, 1.0);
+    vec4 positionWorld = vec4(
+        dot(instance.modelRows[0], positionModel),
+        dot(instance.modelRows[1], positionModel),
+        dot(instance.modelRows[2], positionModel),
+        1.0);
     gl_Position = ubo.projection * ubo.view * positionWorld;
 
-    fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+    vec3 scaledNormal = normal * instance.inverseScaleSquared;
+    fragNormalWorld = normalize(vec3(
+        dot(instance.modelRows[0].xyz, scaledNormal),
+        dot(instance.modelRows[1].xyz, scaledNormal),
+        dot(instance.modelRows[2].xyz, scaledNormal)));
     fragPosWorld = positionWorld.xyz;
     fragColor = color;
     fragTexCoord = uv;
+    fragTextureId = instance.textureId;
+    fragLights = instance.lights;
 
 }
\ No newline at end of file
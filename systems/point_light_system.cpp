@@ -10,39 +10,63 @@
 
 #include <stdexcept>
 #include <iostream>
-#include <map>
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstring>
 
 namespace lve {
 
-    struct PointLightPushConstants {
-        glm::vec4 position{};
-        glm::vec4 color{};
-        float radius;
+    // One per drawn light in the per-frame billboard buffer. Must match LightBillboard in point_light.vert.
+    struct LightBillboard {
+        glm::vec4 position{};  // w is the billboard radius
+        glm::vec4 color{};     // w is intensity
     };
-    PointLightSystem::PointLightSystem(LveDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : lveDevice{device} {
+
+    namespace {
+        // Distance at which a light's 1/d^2 falloff drops below LIGHT_CUTOFF.
+        float lightRange(float brightness) {
+            return std::sqrt(brightness / PointLightSystem::LIGHT_CUTOFF);
+        }
+
+        // The windowed inverse square falloff of simple_shader.frag.
+        float attenuation(float distance, float range) {
+            float ratio = distance / range;
+            float window = std::clamp(1.f - ratio * ratio * ratio * ratio, 0.f, 1.f);
+            return window * window / std::max(distance * distance, 0.01f);
+        }
+
+        bool reachesFrustum(const std::array<glm::vec4, 6> &planes, const glm::vec3 &center, float range) {
+            for (const auto &plane : planes) {
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -range) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    PointLightSystem::PointLightSystem(
+            LveDevice &device, LvePipelineCompiler &pipelineCompiler, VkRenderPass renderPass,
+            VkDescriptorSetLayout globalSetLayout) : lveDevice{device} {
         createPipelineLayout(globalSetLayout);
-        createPipeline(renderPass);
+        createPipeline(pipelineCompiler, renderPass);
     }
 
     PointLightSystem::~PointLightSystem() {
+        lvePipeline->wait();  // its compile uses the layout
         vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
     }
 
     void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(PointLightPushConstants);
-
         std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
 
         VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
         pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
         pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
+        pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
 
         if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutCreateInfo, nullptr, &pipelineLayout) !=
             VK_SUCCESS) {
@@ -50,21 +74,20 @@ namespace lve {
         }
     }
 
-    void PointLightSystem::createPipeline(VkRenderPass renderPass) {
+    void PointLightSystem::createPipeline(LvePipelineCompiler &pipelineCompiler, VkRenderPass renderPass) {
         assert (pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-        PipelineConfigInfo pipelineConfig{};
-        LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
-        LvePipeline::enableAlphaBlending(pipelineConfig);
-        pipelineConfig.attributeDescriptions.clear();
-        pipelineConfig.bindingDescriptions.clear();
-        pipelineConfig.renderPass = renderPass;
-        pipelineConfig.pipelineLayout = pipelineLayout;
-        lvePipeline = std::make_unique<LvePipeline>(
-                lveDevice,
+        auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+        LvePipeline::defaultPipelineConfigInfo(*pipelineConfig);
+        LvePipeline::enableAlphaBlending(*pipelineConfig);
+        pipelineConfig->attributeDescriptions.clear();
+        pipelineConfig->bindingDescriptions.clear();
+        pipelineConfig->renderPass = renderPass;
+        pipelineConfig->pipelineLayout = pipelineLayout;
+        lvePipeline = pipelineCompiler.compileGraphics(
                 "../shaders/point_light.vert.spv",
                 "../shaders/point_light.frag.spv",
-                pipelineConfig
+                std::move(pipelineConfig)
         );
     }
 
@@ -72,68 +95,148 @@ namespace lve {
 
         auto rotateLight = glm::rotate(glm::mat4(1.f), frameInfo.frameTime, {0.f, -1.f, 0.f});
 
-        int lightIndex = 0;
-        for (auto& kv: frameInfo.gameObjects) {
-            auto& obj = kv.second;
-            if (obj.pointLight == nullptr) continue;
-
-            assert(lightIndex < MAX_LIGHTS && "Too many lights in scene");
+        // At least one entry, so the light buffer range is never empty.
+        const auto &lightIds = frameInfo.gameObjects.withPointLight();
+        auto lightAllocation = frameInfo.frameAllocator.allocate(
+                sizeof(PointLight) * std::max<size_t>(lightIds.size(), 1));
+        auto *lights = static_cast<PointLight *>(lightAllocation.data);
+        const auto frustumPlanes = frameInfo.camera.getFrustumPlanes();
+        const bool buildObjectLists = objectLightLists && frameInfo.sceneBvh != nullptr;
+
+        viewSpaceLights.clear();
+        objectLights.clear();
+        objectLightWeights.clear();
+        lightStats = {};
+        lightStats.lights = static_cast<uint32_t>(lightIds.size());
+        uint32_t lightCount = 0;
+        for (auto id: lightIds) {
+            auto& obj = frameInfo.gameObjects.at(id);
 
             // udpate light position
             //obj.transform.translation = glm::vec3(rotateLight * glm::vec4(obj.transform.translation,1.0f));
 
-            // Copy light to ubo
-            ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation,1.0f);
-            ubo.pointLights[lightIndex].color = glm::vec4(obj.color,obj.pointLight->lightIntensity);
+            // Lights only reach as far as their range, so one whose range misses the view can't
+            // light anything visible.
+            float brightness = obj.pointLight->lightIntensity *
+                    std::max({std::abs(obj.color.r), std::abs(obj.color.g), std::abs(obj.color.b)});
+            float range = lightRange(brightness);
+            if (range <= 0.f || !reachesFrustum(frustumPlanes, obj.transform.translation, range)) {
+                continue;
+            }
+
+            // Copy light to the light buffer
+            lights[lightCount].position = glm::vec4(obj.transform.translation,range);
+            lights[lightCount].color = glm::vec4(obj.color,obj.pointLight->lightIntensity);
+            viewSpaceLights.emplace_back(
+                    glm::vec3(frameInfo.camera.getView() * glm::vec4(obj.transform.translation,1.0f)), range);
+            if (buildObjectLists) {
+                addToObjectLists(frameInfo, lightCount, obj.transform.translation, range, brightness);
+            }
+            lightCount++;
+        }
+        lightStats.visible = lightCount;
+
+        frameInfo.objectLights = nullptr;
+        if (buildObjectLists) {
+            frameInfo.objectLights = &objectLights;
+            lightStats.litObjects = static_cast<uint32_t>(objectLights.size());
+            for (uint32_t i = 0; i < objectLights.size(); i++) {
+                for (uint32_t slot = 0; slot < MAX_OBJECT_LIGHTS && objectLights.valueAt(i)[slot] != NO_LIGHT; slot++) {
+                    lightStats.objectLightReferences++;
+                }
+            }
+        }
+
+        lightClusters.build(frameInfo.camera.getProjection(), viewSpaceLights);
+        const auto &clusterData = lightClusters.getData();
+        auto clusterAllocation = frameInfo.frameAllocator.allocate(sizeof(uint32_t) * clusterData.size());
+        std::memcpy(clusterAllocation.data, clusterData.data(), sizeof(uint32_t) * clusterData.size());
+
+        frameInfo.lightDataOffset = lightAllocation.offset;
+        frameInfo.lightClusterOffset = clusterAllocation.offset;
+        ubo.clusterCounts = glm::uvec4(LveLightClusters::TILES_X, LveLightClusters::TILES_Y,
+                                       LveLightClusters::SLICES, lightCount);
+        ubo.clusterParams = lightClusters.getParams(
+                static_cast<float>(frameInfo.extent.width), static_cast<float>(frameInfo.extent.height));
+    }
 
-            lightIndex += 1;
+    void PointLightSystem::addToObjectLists(
+            FrameInfo &frameInfo, uint32_t lightIndex, const glm::vec3 &center, float range, float brightness) {
+        nearbyObjects.clear();
+        frameInfo.sceneBvh->querySphere(center, range, nearbyObjects);
+        for (auto id : nearbyObjects) {
+            // How bright the light is at the nearest point of the object's bounds.
+            glm::vec4 bounds = frameInfo.gameObjects.at(id).getWorldBoundingSphere();
+            float distance = std::max(glm::length(glm::vec3(bounds) - center) - bounds.w, 0.f);
+            float weight = brightness * attenuation(distance, range);
+
+            if (!objectLights.contains(id)) {
+                objectLights.emplace(id, glm::uvec4{NO_LIGHT});
+                objectLightWeights.emplace(id, glm::vec4{0.f});
+            }
+            glm::vec4 &weights = objectLightWeights.at(id);
+            if (weight <= weights[MAX_OBJECT_LIGHTS - 1]) {
+                continue;
+            }
+
+            // Insertion into the list, which is kept sorted by weight.
+            glm::uvec4 &list = objectLights.at(id);
+            uint32_t slot = MAX_OBJECT_LIGHTS - 1;
+            for (; slot > 0 && weights[slot - 1] < weight; slot--) {
+                weights[slot] = weights[slot - 1];
+                list[slot] = list[slot - 1];
+            }
+            weights[slot] = weight;
+            list[slot] = lightIndex;
         }
-        ubo.numLights = lightIndex;
     }
 
-    void PointLightSystem::render(FrameInfo &frameInfo) {
-        // Sort the lights
-        std::map<float, LveGameObject::id_t> sorted;
-        for (auto& kv: frameInfo.gameObjects) {
-            auto &obj = kv.second;
-            if (obj.pointLight == nullptr) continue;
+    void PointLightSystem::submit(FrameInfo &frameInfo, LveRenderQueue &renderQueue) {
+        LvePipeline *pipeline = lvePipeline->get();
+        if (pipeline == nullptr) {
+            return;  // still compiling
+        }
 
-            float offset = glm::length(frameInfo.camera.getCameraPos() - obj.transform.translation);
+        // The billboards are blended, so they are sorted back to front by their exact squared
+        // distance; the radix sort is stable, so lights at the same distance keep their order.
+        const auto &lightIds = frameInfo.gameObjects.withPointLight();
+        const auto frustumPlanes = frameInfo.camera.getFrustumPlanes();
+        billboardOrder.clear();
+        billboardOrder.reserve(lightIds.size());
+        for (uint32_t i = 0; i < lightIds.size(); i++) {
+            auto &obj = frameInfo.gameObjects.at(lightIds[i]);
+            if (!reachesFrustum(frustumPlanes, obj.transform.translation, obj.transform.scale.x)) {
+                continue;
+            }
+
+            glm::vec3 offset = frameInfo.camera.getCameraPos() - obj.transform.translation;
             float disSquared = glm::dot(offset,offset);
-            sorted[disSquared] = obj.getId();
+            billboardOrder.push_back({~LveRenderQueue::floatKey(disSquared), i});
         }
-        lvePipeline->bind(frameInfo.commandBuffer);
-
-        vkCmdBindDescriptorSets(
-                frameInfo.commandBuffer,
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                pipelineLayout,
-                0, 1,
-                &frameInfo.globalDescriptorSet,
-                0, nullptr);
-
-        // Iterated through in reverese order of distance
-        for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
-            auto &obj = frameInfo.gameObjects.at(it->second);
-            //if (obj.pointLight == nullptr) continue;
-
-            PointLightPushConstants push{};
-            push.position = glm::vec4(obj.transform.translation,1.0f);
-            push.color = glm::vec4(obj.color,obj.pointLight->lightIntensity);
-            push.radius = obj.transform.scale.x;
-
-            vkCmdPushConstants(
-                    frameInfo.commandBuffer,
-                    pipelineLayout,
-                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                    0,
-                    sizeof(PointLightPushConstants),
-                    &push);
-
-            vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
+        if (billboardOrder.empty()) {
+            return;
         }
-
-
+        LveRenderQueue::radixSort(billboardOrder, billboardScratch);
+
+        auto allocation = frameInfo.frameAllocator.allocate(sizeof(LightBillboard) * billboardOrder.size());
+        auto *billboards = static_cast<LightBillboard *>(allocation.data);
+        for (size_t i = 0; i < billboardOrder.size(); i++) {
+            auto &obj = frameInfo.gameObjects.at(lightIds[billboardOrder[i].index]);
+            billboards[i].position = glm::vec4(obj.transform.translation,obj.transform.scale.x);
+            billboards[i].color = glm::vec4(obj.color,obj.pointLight->lightIntensity);
+        }
+        frameInfo.lightBillboardOffset = allocation.offset;
+
+        // All of them are one instanced draw, queued at the depth of the farthest.
+        const auto &obj = frameInfo.gameObjects.at(lightIds[billboardOrder.front().index]);
+        glm::vec3 offset = frameInfo.camera.getCameraPos() - obj.transform.translation;
+
+        LveRenderQueue::DrawPacket packet{};
+        packet.pipeline = pipeline;
+        packet.pipelineLayout = pipelineLayout;
+        packet.vertexCount = 6;
+        packet.instanceCount = static_cast<uint32_t>(billboardOrder.size());
+        renderQueue.submit(LveRenderQueue::transparentKey(pipeline->getId(), glm::dot(offset,offset)), packet);
     }
 
 }
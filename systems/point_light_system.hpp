@@ -8,8 +8,11 @@
 #include "lve_camera.hpp"
 #include "lve_game_object.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
 #include "lve_device.hpp"
 #include "lve_frame_info.hpp"
+#include "lve_light_clusters.hpp"
+#include "lve_render_queue.hpp"
 
 #include <memory>
 #include <vector>
@@ -18,21 +21,60 @@ namespace lve {
     class PointLightSystem {
 
     public:
-        PointLightSystem(LveDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+        // Attenuated brightness below which a light counts as having no effect; it sets the range
+        // of each light from its intensity and color.
+        static constexpr float LIGHT_CUTOFF = 1.f / 256.f;
+
+        struct LightStats {
+            uint32_t lights = 0;
+            uint32_t visible = 0;                // lights whose range reaches into the view frustum
+            uint32_t litObjects = 0;             // objects with a light list
+            uint32_t objectLightReferences = 0;  // sum of the light list lengths
+        };
+
+        // The billboard pipeline compiles on pipelineCompiler's threads; no billboards are drawn until it is ready.
+        PointLightSystem(LveDevice &device, LvePipelineCompiler &pipelineCompiler, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
         ~PointLightSystem();
 
         PointLightSystem(const PointLightSystem&) = delete;
         PointLightSystem &operator=(const PointLightSystem&) = delete;
 
+        // Writes the lights whose range reaches into the view, and their cluster lists, to the frame
+        // allocator, and sets their dynamic offsets in frameInfo and the cluster grid in ubo.
+        // frameInfo.extent must be set. With object light lists it also sets frameInfo.objectLights,
+        // using frameInfo.sceneBvh to find the objects in range of each light.
         void update(FrameInfo &frameInfo, GlobalUbo &ubo);
-        void render(FrameInfo &frameInfo);
+        // Writes the billboards of the lights in view back to front into a per-frame buffer, bound
+        // at frameInfo.lightBillboardOffset, and queues them as one instanced draw.
+        void submit(FrameInfo &frameInfo, LveRenderQueue &renderQueue);
+
+        // Gives every object the MAX_OBJECT_LIGHTS lights that are brightest at its bounds, which
+        // the shader loops over instead of its cluster's lights. Cheaper per fragment, but objects
+        // in range of more lights than that lose the dimmest ones.
+        void setObjectLightLists(bool enabled) { objectLightLists = enabled; }
+
+        const LveLightClusters::Stats &getClusterStats() const { return lightClusters.getStats(); }
+        const LightStats &getLightStats() const { return lightStats; }
     private:
         void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-        void createPipeline(VkRenderPass renderPass);
+        void createPipeline(LvePipelineCompiler &pipelineCompiler, VkRenderPass renderPass);
+        void addToObjectLists(FrameInfo &frameInfo, uint32_t lightIndex, const glm::vec3 &center, float range,
+                              float brightness);
 
         LveDevice& lveDevice;
-        std::unique_ptr<LvePipeline> lvePipeline;
+        std::shared_ptr<LveAsyncPipeline> lvePipeline;
         VkPipelineLayout pipelineLayout;
+
+        LveLightClusters lightClusters;
+        std::vector<glm::vec4> viewSpaceLights;  // xyz center, w range
+        bool objectLightLists = false;
+        LveSparseSet<glm::uvec4> objectLights;       // light buffer indices per object id
+        LveSparseSet<glm::vec4> objectLightWeights;  // brightness of each of those lights at the object
+        std::vector<uint32_t> nearbyObjects;
+        LightStats lightStats;
+        // Kept between frames so sorting the billboards stops allocating once they have grown.
+        std::vector<LveRenderQueue::SortItem> billboardOrder;  // indices into withPointLight()
+        std::vector<LveRenderQueue::SortItem> billboardScratch;
     };
 }
 
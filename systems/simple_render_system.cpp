@@ -8,95 +8,827 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 #include <array>
 
 namespace lve {
 
-    struct SimplePushConstantData {
-        glm::mat4 modelMatrix{1.f};
-        glm::mat4 normalMatrix{1.f}; // Is really just a 3x3 matrix, so we will use the extra values to send data.
-        // normalMatrix[3][3] will be the textureBinding;
+    // One entry per drawn object in the per-frame instance buffer, read in the vertex shader
+    // through gl_InstanceIndex. Must match InstanceData in simple_shader.vert.
+    //
+    // The model matrix is stored as its top three rows; the bottom row is always (0, 0, 0, 1).
+    // The normal matrix R * S^-1 equals the model's upper 3x3 times S^-2, so only the inverse
+    // squared scale (one over each squared column length) is stored and the shader rebuilds it.
+    struct SimpleRenderSystem::InstanceData {
+        glm::vec4 modelRows[3];
+        glm::vec3 inverseScaleSquared{1.f};
+        int32_t textureId = -1;
+        glm::uvec4 lights{CLUSTERED_LIGHTS};  // light list, see MAX_OBJECT_LIGHTS
+
+        void set(const LveGameObject &gameObject, const LveSparseSet<glm::uvec4> *objectLights) {
+            const glm::mat4 &modelMatrix = gameObject.getWorldTransform();
+            for (int row = 0; row < 3; row++) {
+                modelRows[row] = {modelMatrix[0][row], modelMatrix[1][row], modelMatrix[2][row], modelMatrix[3][row]};
+            }
+            for (int column = 0; column < 3; column++) {
+                glm::vec3 axis{modelMatrix[column]};
+                inverseScaleSquared[column] = 1.f / glm::dot(axis, axis);
+            }
+            textureId = gameObject.textureBinding;
+            lights = lightsOf(gameObject.getId(), objectLights);
+        }
+
+        static glm::uvec4 lightsOf(LveGameObject::id_t id, const LveSparseSet<glm::uvec4> *objectLights) {
+            if (objectLights == nullptr) {
+                return glm::uvec4{CLUSTERED_LIGHTS};
+            }
+            const glm::uvec4 *list = objectLights->find(id);
+            return list != nullptr ? *list : glm::uvec4{NO_LIGHT};
+        }
+    };
+
+    // Input of the culling passes, one per game object id in the object buffer. Must match
+    // ObjectData in cull.glsl.
+    struct SimpleRenderSystem::ObjectData {
+        InstanceData instance;
+        glm::vec4 boundingSphere{0.f};
+        uint32_t drawIndex = NO_DRAW;
+        uint32_t padding[3]{};
     };
 
-    // 16 bytes for offset, 12 bytes for color - aligns to 16 bytes.
-    // Each new value must end or begin on a 4 byte boundary.
-    uint32_t pushConstantDataSize = sizeof(SimplePushConstantData); //16 + 12;
+    // Must match CullBuffer in cull.glsl.
+    struct SimpleRenderSystem::CullData {
+        glm::mat4 view;
+        glm::vec4 frustumPlanes[6];
+        glm::vec4 projection;  // [0][0], [1][1], [2][2] and [3][2] of the projection matrix
+        uint32_t objectCount;
+        uint32_t occlusionCulling;
+        uint32_t lateInstanceBase;  // where the late pass's instances start
+        uint32_t padding;
+    };
 
-    SimpleRenderSystem::SimpleRenderSystem(LveDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : lveDevice{device} {
+    SimpleRenderSystem::SimpleRenderSystem(
+            LveDevice &device, LvePipelineCompiler &pipelineCompiler, VkRenderPass renderPass,
+            VkDescriptorSetLayout globalSetLayout) : lveDevice{device} {
         createPipelineLayout(globalSetLayout);
-        createPipeline(renderPass);
+        createPipeline(pipelineCompiler, renderPass);
+        createCullPipeline(pipelineCompiler);
     }
 
     SimpleRenderSystem::~SimpleRenderSystem() {
+        // The compiles still in flight use the layouts.
+        for (auto *pipeline : {&lvePipeline, &depthEqualPipeline, &depthPrepassPipeline, &cullPipeline, &lateCullPipeline}) {
+            (*pipeline)->wait();
+        }
+        vkDestroyPipelineLayout(lveDevice.device(), cullPipelineLayout, nullptr);
         vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
     }
 
     void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = pushConstantDataSize;
-
         std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
 
         VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
         pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
         pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
+        pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
 
         if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutCreateInfo, nullptr, &pipelineLayout) !=
             VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
         }
     }
-
-    void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
+    void SimpleRenderSystem::createPipeline(LvePipelineCompiler &pipelineCompiler, VkRenderPass renderPass) {
         assert (pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-        PipelineConfigInfo pipelineConfig{};
-        LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+        auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+        LvePipeline::defaultPipelineConfigInfo(*pipelineConfig);
 
-        pipelineConfig.renderPass = renderPass;
-        pipelineConfig.pipelineLayout = pipelineLayout;
-        lvePipeline = std::make_unique<LvePipeline>(
-                lveDevice,
+        pipelineConfig->renderPass = renderPass;
+        pipelineConfig->pipelineLayout = pipelineLayout;
+        lvePipeline = pipelineCompiler.compileGraphics(
+                "../shaders/simple_shader.vert.spv",
+                "../shaders/simple_shader.frag.spv",
+                std::move(pipelineConfig)
+        );
+
+        auto equalConfig = std::make_unique<PipelineConfigInfo>();
+        LvePipeline::defaultPipelineConfigInfo(*equalConfig);
+        LvePipeline::enableDepthEqualTest(*equalConfig);
+        equalConfig->renderPass = renderPass;
+        equalConfig->pipelineLayout = pipelineLayout;
+        depthEqualPipeline = pipelineCompiler.compileGraphics(
                 "../shaders/simple_shader.vert.spv",
                 "../shaders/simple_shader.frag.spv",
-                pipelineConfig
+                std::move(equalConfig)
+        );
+
+        // No fragment shader: the prepass only writes depth.
+        auto prepassConfig = std::make_unique<PipelineConfigInfo>();
+        LvePipeline::defaultPipelineConfigInfo(*prepassConfig);
+        LvePipeline::enableDepthPrepass(*prepassConfig);
+        prepassConfig->renderPass = renderPass;
+        prepassConfig->pipelineLayout = pipelineLayout;
+        depthPrepassPipeline = pipelineCompiler.compileGraphics(
+                "../shaders/depth_prepass.vert.spv",
+                "",
+                std::move(prepassConfig)
         );
     }
 
-    void SimpleRenderSystem::render(FrameInfo &frameInfo) {
-        lvePipeline->bind(frameInfo.commandBuffer);
+    void SimpleRenderSystem::createCullPipeline(LvePipelineCompiler &pipelineCompiler) {
+        cullSetLayout = LveDescriptorSetLayout::Builder(lveDevice)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // objects
+                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT) // instances
+                .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT) // draw commands
+                .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT) // cull data
+                .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // visibility
+                .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT) // first instances
+                .build();
+        occlusionSetLayout = LveDescriptorSetLayout::Builder(lveDevice)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // depth pyramid
+                .build();
+
+        // Both passes share the layout; only cull_late.comp uses the second set.
+        std::array<VkDescriptorSetLayout, 2> setLayouts{
+                cullSetLayout->getDescriptorSetLayout(), occlusionSetLayout->getDescriptorSetLayout()};
+        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+        pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
+        pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+
+        if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutCreateInfo, nullptr, &cullPipelineLayout) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create cull pipeline layout!");
+        }
+
+        cullPipeline = pipelineCompiler.compileCompute("../shaders/cull.comp.spv", cullPipelineLayout);
+        lateCullPipeline = pipelineCompiler.compileCompute("../shaders/cull_late.comp.spv", cullPipelineLayout);
+    }
+
+    void SimpleRenderSystem::updateCullDescriptorSet(FrameInfo &frameInfo) {
+        constexpr uint32_t frameCount = LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+        if (cullPool == nullptr) {
+            cullPool = LveDescriptorPool::Builder(lveDevice)
+                    .setMaxSets(frameCount + 1)
+                    .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 4 * frameCount)
+                    .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * frameCount)
+                    .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)
+                    .build();
+        }
+
+        cullDescriptorSet = cullDescriptorSets[frameInfo.frameIndex];
+        if (cullDescriptorSet != VK_NULL_HANDLE && cullSetVersions[frameInfo.frameIndex] == cullBufferVersion) {
+            return;
+        }
+
+        // The dynamic ones live in the frame allocator; the dynamic offsets pick this frame's ranges,
+        // so their ranges are bounded: the instances, commands and first instances by one frame's
+        // worth of the allocator, the cull data by its size. The frame that last used this set has
+        // finished, so it can be rewritten now.
+        auto objectInfo = objectBuffer->descriptorInfo();
+        auto bufferInfo = frameInfo.frameAllocator.descriptorInfo(frameInfo.frameAllocator.getBytesPerFrame());
+        auto cullDataInfo = frameInfo.frameAllocator.descriptorInfo(sizeof(CullData));
+        auto visibilityInfo = visibilityBuffer->descriptorInfo();
+        LveDescriptorWriter writer{*cullSetLayout, *cullPool};
+        writer.writeBuffer(0, &objectInfo)
+                .writeBuffer(1, &bufferInfo)
+                .writeBuffer(2, &bufferInfo)
+                .writeBuffer(3, &cullDataInfo)
+                .writeBuffer(4, &visibilityInfo)
+                .writeBuffer(5, &bufferInfo);
+        if (cullDescriptorSet == VK_NULL_HANDLE) {
+            writer.build(cullDescriptorSet);
+        } else {
+            writer.overwrite(cullDescriptorSet);
+        }
+        cullDescriptorSets[frameInfo.frameIndex] = cullDescriptorSet;
+        cullSetVersions[frameInfo.frameIndex] = cullBufferVersion;
+    }
+
+    void SimpleRenderSystem::reserveVisibility(FrameInfo &frameInfo, uint32_t idCount) {
+        if (visibilityBuffer != nullptr && visibilityBuffer->getInstanceCount() >= idCount) {
+            return;
+        }
+        uint32_t capacity = std::max(idCount, MIN_ID_CAPACITY);
+        if (visibilityBuffer != nullptr) {
+            capacity = std::max(capacity, 2 * visibilityBuffer->getInstanceCount());
+            // The other frame in flight may still use the old buffer through its cull descriptor set.
+            retiredBuffers[frameInfo.frameIndex].push_back(std::move(visibilityBuffer));
+        }
+        cullBufferVersion++;
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        visibilityBuffer = std::make_unique<LveBuffer>(
+                lveDevice,
+                sizeof(uint32_t),
+                capacity,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        // Nothing counts as visible last frame, so the late pass draws everything that passes.
+        vkCmdFillBuffer(commandBuffer, visibilityBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
+    }
+
+    void SimpleRenderSystem::reserveObjects(FrameInfo &frameInfo, uint32_t idCount) {
+        if (objectBuffer != nullptr && objectBuffer->getInstanceCount() >= idCount) {
+            return;
+        }
+        uint32_t capacity = std::max(idCount, MIN_ID_CAPACITY);
+        std::unique_ptr<LveBuffer> oldBuffer = std::move(objectBuffer);
+        if (oldBuffer != nullptr) {
+            capacity = std::max(capacity, 2 * oldBuffer->getInstanceCount());
+        }
+        cullBufferVersion++;
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        objectBuffer = std::make_unique<LveBuffer>(
+                lveDevice,
+                sizeof(ObjectData),
+                capacity,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        VkDeviceSize keptSize = 0;
+        if (oldBuffer != nullptr) {
+            // The records carry over; last frame's uploads must have landed before they are read.
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(
+                    commandBuffer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    0,
+                    1, &barrier,
+                    0, nullptr,
+                    0, nullptr);
+            keptSize = oldBuffer->getBufferSize();
+            VkBufferCopy region{0, 0, keptSize};
+            vkCmdCopyBuffer(commandBuffer, oldBuffer->getBuffer(), objectBuffer->getBuffer(), 1, &region);
+            // The other frame in flight may still use the old buffer through its cull descriptor set.
+            retiredBuffers[frameInfo.frameIndex].push_back(std::move(oldBuffer));
+        }
+        // All ones makes every new record empty (drawIndex NO_DRAW).
+        vkCmdFillBuffer(commandBuffer, objectBuffer->getBuffer(), keptSize, VK_WHOLE_SIZE, 0xffffffffu);
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
+    }
+
+    void SimpleRenderSystem::updateScene(FrameInfo &frameInfo) {
+        auto &gameObjects = frameInfo.gameObjects;
+        if (sceneBuilt && sceneStructureVersion == gameObjects.getStructureVersion()) {
+            return;
+        }
+        sceneBuilt = true;
+        sceneStructureVersion = gameObjects.getStructureVersion();
+
+        // Count the objects per model; a model seen for the first time takes a free group index.
+        for (auto &group : sceneGroups) {
+            group.instanceCount = 0;
+        }
+        sceneIdCount = 0;
+        for (auto id : gameObjects.withModel()) {
+            sceneIdCount = std::max(sceneIdCount, id + 1);
+        }
+        // Ids past the new range keep their slot, so records left there are still emptied.
+        nextDrawIndices.assign(std::max<size_t>(sceneIdCount, recordDrawIndices.size()), NO_DRAW);
+        for (auto id : gameObjects.withModel()) {
+            const auto &model = gameObjects.at(id).model;
+            auto [entry, inserted] = sceneGroupIndices.try_emplace(model.get(), 0);
+            if (inserted) {
+                if (freeGroups.empty()) {
+                    entry->second = static_cast<uint32_t>(sceneGroups.size());
+                    sceneGroups.emplace_back();
+                    sceneModels.emplace_back();
+                } else {
+                    entry->second = freeGroups.back();
+                    freeGroups.pop_back();
+                }
+                sceneGroups[entry->second] = {model.get(), 0, 0, 0.f};
+                sceneModels[entry->second] = model;
+            }
+            sceneGroups[entry->second].instanceCount++;
+            nextDrawIndices[id] = entry->second;
+        }
+
+        // Each group gets a range of instance slots; models no object uses any more free their index.
+        sceneInstanceCount = 0;
+        for (uint32_t g = 0; g < sceneGroups.size(); g++) {
+            auto &group = sceneGroups[g];
+            if (group.model != nullptr && group.instanceCount == 0) {
+                sceneGroupIndices.erase(group.model);
+                sceneModels[g].reset();
+                group.model = nullptr;
+                freeGroups.push_back(g);
+            }
+            group.firstInstance = sceneInstanceCount;
+            sceneInstanceCount += group.instanceCount;
+        }
+
+        uint32_t slotCount = static_cast<uint32_t>(nextDrawIndices.size());
+        reserveObjects(frameInfo, slotCount);
+        reserveVisibility(frameInfo, slotCount);
+        recordDrawIndices.resize(slotCount, NO_DRAW);
+        recordLights.resize(slotCount, glm::uvec4{NO_LIGHT});
+        recordDirty.resize(slotCount, 0);
+        // Only the added, removed and re-modeled objects have a record that no longer matches.
+        for (LveGameObject::id_t id = 0; id < slotCount; id++) {
+            if (nextDrawIndices[id] != recordDrawIndices[id]) {
+                markDirty(id);
+            }
+        }
+        recordDrawIndices.swap(nextDrawIndices);
+    }
+
+    void SimpleRenderSystem::markLightsDirty(FrameInfo &frameInfo) {
+        const LveSparseSet<glm::uvec4> *objectLights = frameInfo.objectLights;
+        auto check = [&](LveGameObject::id_t id) {
+            if (id < recordDrawIndices.size() && recordDrawIndices[id] != NO_DRAW &&
+                recordLights[id] != InstanceData::lightsOf(id, objectLights)) {
+                markDirty(id);
+            }
+        };
+
+        bool useObjectLights = objectLights != nullptr;
+        if (useObjectLights != recordsUseObjectLights) {
+            // Every record switches between its own list and the clustered lights.
+            for (auto id : frameInfo.gameObjects.withModel()) {
+                check(id);
+            }
+        } else if (useObjectLights) {
+            // Only an object with a list in this frame or the last can have a changed one.
+            for (auto id : litIds) {
+                check(id);
+            }
+            for (auto id : objectLights->ids()) {
+                check(id);
+            }
+        }
+        recordsUseObjectLights = useObjectLights;
+        litIds.clear();
+        if (useObjectLights) {
+            litIds = objectLights->ids();
+        }
+    }
+
+    void SimpleRenderSystem::markDirty(LveGameObject::id_t id) {
+        if (!recordDirty[id]) {
+            recordDirty[id] = 1;
+            dirtyIds.push_back(id);
+        }
+    }
+
+    void SimpleRenderSystem::uploadObjects(FrameInfo &frameInfo) {
+        if (dirtyIds.empty()) {
+            return;
+        }
+
+        // The frame that last used this staging buffer has finished, so it can be rewritten or replaced.
+        auto &stagingBuffer = stagingBuffers[frameInfo.frameIndex];
+        uint32_t recordCount = static_cast<uint32_t>(dirtyIds.size());
+        if (stagingBuffer == nullptr || stagingBuffer->getInstanceCount() < recordCount) {
+            uint32_t capacity = std::max(recordCount, MIN_ID_CAPACITY);
+            if (stagingBuffer != nullptr) {
+                capacity = std::max(capacity, 2 * stagingBuffer->getInstanceCount());
+            }
+            stagingBuffer = std::make_unique<LveBuffer>(
+                    lveDevice,
+                    sizeof(ObjectData),
+                    capacity,
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            stagingBuffer->map();
+        }
+
+        // Sorted, runs of neighbouring ids become one copy region.
+        std::sort(dirtyIds.begin(), dirtyIds.end());
+        auto *records = static_cast<ObjectData *>(stagingBuffer->getMappedMemory());
+        uploadRegions.clear();
+        for (uint32_t i = 0; i < recordCount; i++) {
+            LveGameObject::id_t id = dirtyIds[i];
+            ObjectData &record = records[i];
+            record = ObjectData{};
+            record.drawIndex = recordDrawIndices[id];
+            if (record.drawIndex != NO_DRAW) {
+                record.instance.set(frameInfo.gameObjects.at(id), frameInfo.objectLights);
+                record.boundingSphere = sceneGroups[record.drawIndex].model->getBoundingSphere();
+                recordLights[id] = record.instance.lights;
+            }
+            recordDirty[id] = 0;
+
+            VkDeviceSize dstOffset = static_cast<VkDeviceSize>(id) * sizeof(ObjectData);
+            if (!uploadRegions.empty() && uploadRegions.back().dstOffset + uploadRegions.back().size == dstOffset) {
+                uploadRegions.back().size += sizeof(ObjectData);
+            } else {
+                uploadRegions.push_back({i * sizeof(ObjectData), dstOffset, sizeof(ObjectData)});
+            }
+        }
+        dirtyIds.clear();
+
+        // Last frame's passes read the records these copies overwrite.
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
+        vkCmdCopyBuffer(
+                commandBuffer,
+                stagingBuffer->getBuffer(),
+                objectBuffer->getBuffer(),
+                static_cast<uint32_t>(uploadRegions.size()),
+                uploadRegions.data());
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
+    }
+
+    void SimpleRenderSystem::submit(FrameInfo &frameInfo, LveRenderQueue &renderQueue, LveThreadPool *threadPool) {
+        prepareInstances(frameInfo);
+
+        // The instance transforms are independent, so enough of them are split over the pool.
+        uint32_t taskCount = 1;
+        if (threadPool != nullptr) {
+            taskCount = static_cast<uint32_t>(std::min<size_t>(
+                    drawList.size() / MIN_OBJECTS_PER_TASK, threadPool->getThreadCount()));
+        }
+        if (taskCount > 1) {
+            size_t objectsPerTask = (drawList.size() + taskCount - 1) / taskCount;
+            threadPool->parallelFor(taskCount, [&](uint32_t taskIndex) {
+                size_t begin = std::min(drawList.size(), taskIndex * objectsPerTask);
+                writeInstances(begin, std::min(drawList.size(), begin + objectsPerTask));
+            });
+        } else {
+            writeInstances(0, drawList.size());
+        }
+
+        for (const auto &group : drawGroups) {
+            LveRenderQueue::DrawPacket packet{};
+            packet.pipelineLayout = pipelineLayout;
+            packet.model = group.model;
+            packet.instanceCount = group.instanceCount;
+            packet.firstInstance = group.firstInstance;
+            submitGroup(renderQueue, packet, group);
+        }
+    }
+
+    void SimpleRenderSystem::submitGroup(
+            LveRenderQueue &renderQueue, LveRenderQueue::DrawPacket &packet, const DrawGroup &group) {
+        // Nothing is drawn without the shading pipeline, so the first frame waits for it; the
+        // prepass is left out until both of its pipelines have compiled.
+        lvePipeline->wait();
+        LvePipeline *shadingPipeline = lvePipeline->get();
+        LvePipeline *prepassPipeline = depthPrepass ? depthPrepassPipeline->get() : nullptr;
+        LvePipeline *equalPipeline = depthEqualPipeline->get();
+        if (prepassPipeline != nullptr && equalPipeline != nullptr) {
+            packet.pipeline = prepassPipeline;
+            renderQueue.submit(
+                    LveRenderQueue::depthPrepassKey(packet.pipeline->getId(), group.model->getId(), group.depth),
+                    packet);
+            shadingPipeline = equalPipeline;
+        }
+        packet.pipeline = shadingPipeline;
+        renderQueue.submit(
+                LveRenderQueue::opaqueKey(shadingPipeline->getId(), 0, group.model->getId(), group.depth),
+                packet);
+    }
+
+    void SimpleRenderSystem::cull(FrameInfo &frameInfo, bool occlusionCulling) {
+        // This frame index's last frame has finished, so what it retired is no longer in use.
+        retiredBuffers[frameInfo.frameIndex].clear();
+        updateScene(frameInfo);
+        markLightsDirty(frameInfo);
+        if (frameInfo.changedTransforms != nullptr) {
+            for (auto id : *frameInfo.changedTransforms) {
+                if (id < recordDrawIndices.size() && recordDrawIndices[id] != NO_DRAW) {
+                    markDirty(id);
+                }
+            }
+        } else {
+            for (auto id : frameInfo.gameObjects.withModel()) {
+                markDirty(id);
+            }
+        }
+        uploadObjects(frameInfo);
+        if (sceneInstanceCount == 0) {
+            return;
+        }
+        updateCullDescriptorSet(frameInfo);
+
+        // With occlusion culling the late pass has its own draw commands, and its instances go
+        // after the early pass's, at lateInstanceBase + firstInstance.
+        auto &frameAllocator = frameInfo.frameAllocator;
+        uint32_t groupCount = static_cast<uint32_t>(sceneGroups.size());
+        uint32_t passCount = occlusionCulling ? 2 : 1;
+        auto instanceAllocation = frameAllocator.allocate(sizeof(InstanceData) * sceneInstanceCount * passCount);
+        auto commandAllocation = frameAllocator.allocate(LveModel::INDIRECT_COMMAND_SIZE * groupCount);
+        LveFrameAllocator::Allocation lateCommandAllocation{};
+        if (occlusionCulling) {
+            lateCommandAllocation = frameAllocator.allocate(LveModel::INDIRECT_COMMAND_SIZE * groupCount);
+        }
+        auto firstInstanceAllocation = frameAllocator.allocate(sizeof(uint32_t) * groupCount);
+
+        CullData cullData{};
+        cullData.view = frameInfo.camera.getView();
+        auto frustumPlanes = frameInfo.camera.getFrustumPlanes();
+        std::copy(frustumPlanes.begin(), frustumPlanes.end(), cullData.frustumPlanes);
+        const glm::mat4 &projection = frameInfo.camera.getProjection();
+        cullData.projection = {projection[0][0], projection[1][1], projection[2][2], projection[3][2]};
+        cullData.objectCount = sceneIdCount;
+        cullData.occlusionCulling = occlusionCulling ? 1 : 0;
+        cullData.lateInstanceBase = sceneInstanceCount;
+        auto cullDataAllocation = frameAllocator.push(cullData);
+
+        frameInfo.instanceDataOffset = instanceAllocation.offset;
+        drawCommandOffset = commandAllocation.offset;
+        lateDrawCommandOffset = lateCommandAllocation.offset;
+        cullOffsets = {instanceAllocation.offset, commandAllocation.offset, cullDataAllocation.offset,
+                       firstInstanceAllocation.offset};
+
+        auto *commands = static_cast<char *>(commandAllocation.data);
+        auto *lateCommands = static_cast<char *>(lateCommandAllocation.data);
+        auto *firstInstances = static_cast<uint32_t *>(firstInstanceAllocation.data);
+        for (uint32_t g = 0; g < groupCount; g++) {
+            const auto &group = sceneGroups[g];
+            firstInstances[g] = group.firstInstance;
+            if (group.model == nullptr) {
+                continue;  // free index, no record points at it
+            }
+            // The compute passes count the visible instances up from zero.
+            group.model->writeIndirectCommand(commands + g * LveModel::INDIRECT_COMMAND_SIZE, 0, group.firstInstance);
+            if (occlusionCulling) {
+                group.model->writeIndirectCommand(
+                        lateCommands + g * LveModel::INDIRECT_COMMAND_SIZE, 0, sceneInstanceCount + group.firstInstance);
+            }
+        }
+
+        if (occlusionCulling) {
+            // The previous frame's late pass wrote the visibility this pass reads.
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(
+                    frameInfo.commandBuffer,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    0,
+                    1, &barrier,
+                    0, nullptr,
+                    0, nullptr);
+        }
+        cullPipeline->wait();
+        dispatchCull(frameInfo.commandBuffer, *cullPipeline->get(), cullOffsets);
+    }
+
+    void SimpleRenderSystem::cullOccluded(FrameInfo &frameInfo, const LveDepthPyramid &depthPyramid) {
+        drawCommandOffset = lateDrawCommandOffset;
+        if (sceneInstanceCount == 0) {
+            return;
+        }
+
+        // A resized pyramid is only recreated after the device went idle, so the set is free.
+        if (occlusionDescriptorSet == VK_NULL_HANDLE || depthPyramidVersion != depthPyramid.getVersion()) {
+            auto pyramidInfo = depthPyramid.descriptorInfo();
+            LveDescriptorWriter writer{*occlusionSetLayout, *cullPool};
+            writer.writeImage(0, &pyramidInfo);
+            if (occlusionDescriptorSet == VK_NULL_HANDLE) {
+                writer.build(occlusionDescriptorSet);
+            } else {
+                writer.overwrite(occlusionDescriptorSet);
+            }
+            depthPyramidVersion = depthPyramid.getVersion();
+        }
+
+        // The early pass read the visibility this pass overwrites.
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+                frameInfo.commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
+                0, nullptr);
 
         vkCmdBindDescriptorSets(
                 frameInfo.commandBuffer,
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                pipelineLayout,
+                VK_PIPELINE_BIND_POINT_COMPUTE,
+                cullPipelineLayout,
+                1, 1,
+                &occlusionDescriptorSet,
+                0, nullptr);
+        std::array<uint32_t, 4> lateOffsets = cullOffsets;
+        lateOffsets[1] = lateDrawCommandOffset;
+        lateCullPipeline->wait();
+        dispatchCull(frameInfo.commandBuffer, *lateCullPipeline->get(), lateOffsets);
+    }
+
+    void SimpleRenderSystem::dispatchCull(
+            VkCommandBuffer commandBuffer, LvePipeline &pipeline, const std::array<uint32_t, 4> &dynamicOffsets) {
+        pipeline.bind(commandBuffer);
+        vkCmdBindDescriptorSets(
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_COMPUTE,
+                cullPipelineLayout,
                 0, 1,
-                &frameInfo.globalDescriptorSet,
+                &cullDescriptorSet,
+                static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+
+        vkCmdDispatch(commandBuffer, (sceneIdCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+        // The draws read the commands and the compacted instances the dispatch wrote.
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                0,
+                1, &barrier,
+                0, nullptr,
                 0, nullptr);
+    }
 
-        for (auto &kv : frameInfo.gameObjects) {
-            auto &gameObject = kv.second;
-            if (gameObject.model == nullptr) continue;
-            SimplePushConstantData push{};
-            push.modelMatrix = gameObject.transform.mat4();
-            push.normalMatrix = gameObject.transform.normalMatrix();
-            push.normalMatrix[3][3] = static_cast<float>(gameObject.textureBinding); // Not ideal, but limited with 128 bytes.
-            vkCmdPushConstants(
-                    frameInfo.commandBuffer,
-                    pipelineLayout,
-                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                    0,
-                    pushConstantDataSize,
-                    &push);
-            gameObject.model->bind(frameInfo.commandBuffer);
-            gameObject.model->draw(frameInfo.commandBuffer);
+    void SimpleRenderSystem::submitIndirect(FrameInfo &frameInfo, LveRenderQueue &renderQueue) {
+        for (size_t g = 0; g < sceneGroups.size(); g++) {
+            const auto &group = sceneGroups[g];
+            if (group.instanceCount == 0) {
+                continue;
+            }
+            LveRenderQueue::DrawPacket packet{};
+            packet.pipelineLayout = pipelineLayout;
+            packet.model = group.model;
+            packet.indirectBuffer = frameInfo.frameAllocator.getBuffer();
+            packet.indirectOffset = drawCommandOffset + g * LveModel::INDIRECT_COMMAND_SIZE;
+            submitGroup(renderQueue, packet, group);
+        }
+    }
+
+    void SimpleRenderSystem::prepareInstances(FrameInfo &frameInfo) {
+        collectDrawList(frameInfo);
+        cullDrawList(frameInfo);
+        sortDrawList(frameInfo);
+        groupDrawList();
+
+        instances = nullptr;
+        objectLights = frameInfo.objectLights;
+        if (!drawList.empty()) {
+            auto allocation = frameInfo.frameAllocator.allocate(sizeof(InstanceData) * drawList.size());
+            instances = static_cast<InstanceData *>(allocation.data);
+            frameInfo.instanceDataOffset = allocation.offset;
+        }
+    }
+
+    void SimpleRenderSystem::collectDrawList(FrameInfo &frameInfo) {
+        drawList.clear();
+        for (auto id : frameInfo.gameObjects.withModel()) {
+            drawList.push_back(&frameInfo.gameObjects.at(id));
+        }
+    }
+
+    void SimpleRenderSystem::cullDrawList(FrameInfo &frameInfo) {
+        cullStats.tested = static_cast<uint32_t>(drawList.size());
+        cullStats.occluded = 0;
+
+        // With a scene BVH, whole subtrees outside (or inside) the frustum are settled at once.
+        if (bvhCulling && frameInfo.sceneBvh != nullptr) {
+            visibleIndices.clear();
+            frameInfo.sceneBvh->queryFrustum(frameInfo.camera.getFrustumPlanes(), visibleIndices);
+            drawList.clear();
+            for (auto id : visibleIndices) {
+                drawList.push_back(&frameInfo.gameObjects.at(id));
+            }
+        } else {
+            frustumCuller.clear();
+            for (const auto *gameObject : drawList) {
+                glm::vec4 sphere = gameObject->getWorldBoundingSphere();
+                frustumCuller.addSphere(glm::vec3{sphere}, sphere.w);
+            }
+
+            visibleIndices.clear();
+            frustumCuller.cull(frameInfo.camera.getFrustumPlanes(), visibleIndices);
+
+            // Indices are ascending, so the list can be compacted in place.
+            for (size_t i = 0; i < visibleIndices.size(); i++) {
+                drawList[i] = drawList[visibleIndices[i]];
+            }
+            drawList.resize(visibleIndices.size());
+        }
+
+        // What is left is on screen; the occlusion rasterizer drops what is behind the occluders.
+        if (frameInfo.occlusionRasterizer != nullptr) {
+            occlusionTested.clear();
+            for (uint32_t i = 0; i < drawList.size(); i++) {
+                // An occluder's box would be tested against its own depth and could lose to rounding.
+                if (drawList[i]->occluder != nullptr) {
+                    continue;
+                }
+                frameInfo.occlusionRasterizer->addBox(
+                        drawList[i]->getWorldTransform(),
+                        drawList[i]->model->getBoundingBoxMin(),
+                        drawList[i]->model->getBoundingBoxMax());
+                occlusionTested.push_back(i);
+            }
+            visibleIndices.clear();
+            frameInfo.occlusionRasterizer->cull(visibleIndices);
+            cullStats.occluded = static_cast<uint32_t>(occlusionTested.size() - visibleIndices.size());
+
+            size_t next = 0;
+            for (size_t i = 0; i < occlusionTested.size(); i++) {
+                if (next < visibleIndices.size() && visibleIndices[next] == i) {
+                    next++;
+                } else {
+                    drawList[occlusionTested[i]] = nullptr;
+                }
+            }
+            drawList.erase(std::remove(drawList.begin(), drawList.end(), nullptr), drawList.end());
+        }
+        cullStats.visible = static_cast<uint32_t>(drawList.size());
+    }
+
+    void SimpleRenderSystem::sortDrawList(FrameInfo &frameInfo) {
+        // Objects sharing a model end up next to each other and become one instanced draw, with the
+        // instances front to back. The texture is per instance data, so it does not split a group.
+        glm::vec3 cameraPosition = frameInfo.camera.getCameraPos();
+        sortItems.clear();
+        for (size_t i = 0; i < drawList.size(); i++) {
+            glm::vec3 offset = glm::vec3{drawList[i]->getWorldTransform()[3]} - cameraPosition;
+            uint64_t key = (static_cast<uint64_t>(drawList[i]->model->getId()) << 32) |
+                           LveRenderQueue::depthBits(glm::dot(offset, offset));
+            sortItems.push_back({key, static_cast<uint32_t>(i)});
+        }
+        LveRenderQueue::radixSort(sortItems, sortScratch);
+
+        sortedDrawList.clear();
+        drawDepths.clear();
+        for (const auto &item : sortItems) {
+            sortedDrawList.push_back(drawList[item.index]);
+            glm::vec3 offset = glm::vec3{drawList[item.index]->getWorldTransform()[3]} - cameraPosition;
+            drawDepths.push_back(glm::dot(offset, offset));
+        }
+        drawList.swap(sortedDrawList);
+    }
+
+    void SimpleRenderSystem::groupDrawList() {
+        drawGroups.clear();
+        for (size_t i = 0; i < drawList.size(); i++) {
+            LveModel *model = drawList[i]->model.get();
+            if (!instancing || drawGroups.empty() || drawGroups.back().model != model) {
+                // The nearest instance comes first, so it gives the group's sort depth.
+                drawGroups.push_back({model, static_cast<uint32_t>(i), 0, drawDepths[i]});
+            }
+            drawGroups.back().instanceCount++;
+        }
+    }
+
+    void SimpleRenderSystem::writeInstances(size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            instances[i].set(*drawList[i], objectLights);
         }
     }
 
@@ -5,33 +5,189 @@
 #ifndef VULKANTEST_SIMPLE_RENDER_SYSTEM_HPP
 #define VULKANTEST_SIMPLE_RENDER_SYSTEM_HPP
 
+#include "lve_buffer.hpp"
 #include "lve_camera.hpp"
+#include "lve_depth_pyramid.hpp"
+#include "lve_descriptors.hpp"
 #include "lve_game_object.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_compiler.hpp"
 #include "lve_device.hpp"
 #include "lve_frame_info.hpp"
+#include "lve_frustum_culler.hpp"
+#include "lve_render_queue.hpp"
+#include "lve_swap_chain.hpp"
+#include "lve_thread_pool.hpp"
 
+#include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace lve {
     class SimpleRenderSystem {
 
     public:
-        SimpleRenderSystem(LveDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+        // Objects tested against the camera frustum by the CPU path in the last frame.
+        struct CullStats {
+            uint32_t tested = 0;
+            uint32_t visible = 0;
+            uint32_t occluded = 0;  // inside the frustum, but hidden by FrameInfo::occlusionRasterizer
+        };
+
+        // The pipelines compile on pipelineCompiler's threads; until the depth prepass pipelines are
+        // ready the objects are drawn without the prepass.
+        SimpleRenderSystem(LveDevice &device, LvePipelineCompiler &pipelineCompiler, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
         ~SimpleRenderSystem();
 
         SimpleRenderSystem(const SimpleRenderSystem&) = delete;
         SimpleRenderSystem &operator=(const SimpleRenderSystem&) = delete;
 
-        void render(FrameInfo &frameInfo);
+        // Objects sharing a model become one instanced draw packet in the render queue; their
+        // transforms go to a per-frame instance buffer from the frame allocator, bound at
+        // frameInfo.instanceDataOffset. With a thread pool, large scenes write the instance
+        // buffer on several threads.
+        void submit(FrameInfo &frameInfo, LveRenderQueue &renderQueue, LveThreadPool *threadPool = nullptr);
+
+        // GPU driven path: the object records live in a device local buffer indexed by game object
+        // id. cull uploads the records of the objects in FrameInfo::changedTransforms, of those
+        // whose light list changed and of those added or removed since the last call, then
+        // dispatches a compute pass that frustum culls every record, fills the instance buffer and
+        // counts the survivors into one indirect draw per model. The draw groups are only rebuilt
+        // when the map's structure version changes, so without changes the CPU cost depends on
+        // the number of models alone. It must be recorded outside the render pass; submitIndirect
+        // then queues the indirect draws of the last cull or cullOccluded.
+        //
+        // An object's texture binding is only read when its record is uploaded.
+        //
+        // With occlusion culling, cull only keeps the objects that passed the occlusion test last
+        // frame. Once those are drawn and the depth pyramid is built from their depth,
+        // cullOccluded tests every object against it, keeps the ones that were not drawn yet but
+        // are visible now, and records the results for the next frame. Drawing last frame's
+        // visible set first is what lets newly uncovered objects appear without a frame of delay.
+        void cull(FrameInfo &frameInfo, bool occlusionCulling = false);
+        void cullOccluded(FrameInfo &frameInfo, const LveDepthPyramid &depthPyramid);
+        void submitIndirect(FrameInfo &frameInfo, LveRenderQueue &renderQueue);
+
+        // With a depth prepass every draw is queued twice: depth only in the prepass, then
+        // shaded with an EQUAL depth test and no depth writes, so the lighting runs once per
+        // pixel however much the opaque geometry overlaps. Worth it for scenes with a lot of
+        // overdraw; otherwise the extra vertex work is a loss.
+        void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+        bool hasDepthPrepass() const { return depthPrepass; }
+
+        // The CPU path frustum culls through FrameInfo::sceneBvh, settling whole subtrees at once.
+        // Off, every object's sphere is tested by LveFrustumCuller instead.
+        void setBvhCulling(bool enabled) { bvhCulling = enabled; }
+
+        // Off, the CPU path queues every object as a draw packet of its own instead of one
+        // instanced packet per model; for measuring how recording scales with the packet count.
+        void setInstancing(bool enabled) { instancing = enabled; }
+
+        const CullStats &getCullStats() const { return cullStats; }
     private:
+        // Below this many objects per task, handing the work to another thread is not worth it.
+        static constexpr size_t MIN_OBJECTS_PER_TASK = 256;
+        static constexpr uint32_t CULL_WORKGROUP_SIZE = 64;  // local_size_x of cull.comp and cull_late.comp
+        static constexpr uint32_t MIN_ID_CAPACITY = 1024;  // of the buffers indexed by game object id
+        static constexpr uint32_t NO_DRAW = 0xffffffffu;    // drawIndex of an empty record, as in cull.glsl
+
         void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-        void createPipeline(VkRenderPass renderPass);
+        void createPipeline(LvePipelineCompiler &pipelineCompiler, VkRenderPass renderPass);
+        void createCullPipeline(LvePipelineCompiler &pipelineCompiler);
+        void updateCullDescriptorSet(FrameInfo &frameInfo);
+        void reserveVisibility(FrameInfo &frameInfo, uint32_t idCount);
+        void reserveObjects(FrameInfo &frameInfo, uint32_t idCount);
+        void updateScene(FrameInfo &frameInfo);
+        void markLightsDirty(FrameInfo &frameInfo);
+        void markDirty(LveGameObject::id_t id);
+        void uploadObjects(FrameInfo &frameInfo);
+        void dispatchCull(VkCommandBuffer commandBuffer, LvePipeline &pipeline, const std::array<uint32_t, 4> &dynamicOffsets);
+        struct InstanceData;
+        struct ObjectData;
+        struct CullData;
+
+        struct DrawGroup {
+            LveModel *model;
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+            float depth;  // squared camera distance of the nearest instance
+        };
+
+        void collectDrawList(FrameInfo &frameInfo);
+        void cullDrawList(FrameInfo &frameInfo);
+        void sortDrawList(FrameInfo &frameInfo);
+        void groupDrawList();
+        void submitGroup(LveRenderQueue &renderQueue, LveRenderQueue::DrawPacket &packet, const DrawGroup &group);
+        void prepareInstances(FrameInfo &frameInfo);
+        void writeInstances(size_t begin, size_t end);
 
         LveDevice& lveDevice;
-        std::unique_ptr<LvePipeline> lvePipeline;
+        std::shared_ptr<LveAsyncPipeline> lvePipeline;
+        std::shared_ptr<LveAsyncPipeline> depthPrepassPipeline;
+        std::shared_ptr<LveAsyncPipeline> depthEqualPipeline;  // lvePipeline, after the prepass
         VkPipelineLayout pipelineLayout;
+        bool depthPrepass = false;
+        bool bvhCulling = true;
+        bool instancing = true;
+
+        std::vector<LveGameObject *> drawList;  // sorted by model, then front to back
+        std::vector<LveGameObject *> sortedDrawList;
+        std::vector<float> drawDepths;          // squared camera distance per drawList entry
+        std::vector<LveRenderQueue::SortItem> sortItems;
+        std::vector<LveRenderQueue::SortItem> sortScratch;
+        std::vector<DrawGroup> drawGroups;
+        LveFrustumCuller frustumCuller;
+        std::vector<uint32_t> visibleIndices;
+        std::vector<uint32_t> occlusionTested;  // drawList indices of the boxes given to the occlusion rasterizer
+        CullStats cullStats;
+        InstanceData *instances = nullptr;      // this frame's instance buffer, one entry per drawList entry
+        const LveSparseSet<glm::uvec4> *objectLights = nullptr;  // frameInfo.objectLights, for writeInstances
+
+        std::shared_ptr<LveAsyncPipeline> cullPipeline;
+        std::shared_ptr<LveAsyncPipeline> lateCullPipeline;
+        VkPipelineLayout cullPipelineLayout;
+        std::unique_ptr<LveDescriptorSetLayout> cullSetLayout;
+        std::unique_ptr<LveDescriptorSetLayout> occlusionSetLayout;
+        std::unique_ptr<LveDescriptorPool> cullPool;
+        // One per frame in flight, so a set is only rewritten once the frame that last used it is done.
+        std::array<VkDescriptorSet, LveSwapChain::MAX_FRAMES_IN_FLIGHT> cullDescriptorSets{};
+        std::array<uint32_t, LveSwapChain::MAX_FRAMES_IN_FLIGHT> cullSetVersions{};
+        uint32_t cullBufferVersion = 0;         // bumped whenever a buffer the cull sets point at is replaced
+        VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE;  // this frame's
+        VkDescriptorSet occlusionDescriptorSet = VK_NULL_HANDLE;
+        uint32_t depthPyramidVersion = 0;       // of the pyramid occlusionDescriptorSet points at
+        std::unique_ptr<LveBuffer> visibilityBuffer;  // per game object id, persists across frames
+        // Replaced buffers, kept until the frame index that retired them comes around again, when
+        // no frame in flight can still use them.
+        std::array<std::vector<std::unique_ptr<LveBuffer>>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> retiredBuffers;
+
+        // The scene as the cull passes see it. A model keeps its group index while objects use it,
+        // so only the records of added, removed or re-modeled objects change at a rebuild.
+        std::vector<DrawGroup> sceneGroups;                  // model is nullptr for a free index; depth 0
+        std::vector<std::shared_ptr<LveModel>> sceneModels;  // keeps the groups' models alive
+        std::unordered_map<const LveModel *, uint32_t> sceneGroupIndices;
+        std::vector<uint32_t> freeGroups;
+        std::vector<uint32_t> recordDrawIndices;  // per id, what its record holds; NO_DRAW when empty
+        std::vector<uint32_t> nextDrawIndices;    // per id, while the groups are rebuilt
+        std::vector<glm::uvec4> recordLights;     // per id, the light list its record holds
+        uint32_t sceneIdCount = 0;                // ids the cull passes run over
+        uint32_t sceneInstanceCount = 0;
+        uint32_t sceneStructureVersion = 0;
+        bool sceneBuilt = false;
+        bool recordsUseObjectLights = false;
+        std::vector<LveGameObject::id_t> litIds;  // ids with a light list in the last frame
+        std::vector<uint8_t> recordDirty;         // per id
+        std::vector<LveGameObject::id_t> dirtyIds;
+        std::vector<VkBufferCopy> uploadRegions;
+        std::unique_ptr<LveBuffer> objectBuffer;  // ObjectData per game object id, device local
+        // Host visible, one per frame in flight; a frame's is rewritten once that frame is done.
+        std::array<std::unique_ptr<LveBuffer>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> stagingBuffers;
+
+        // Instances, draw commands, CullData and first instances of this frame in the frame allocator.
+        std::array<uint32_t, 4> cullOffsets{};
+        uint32_t lateDrawCommandOffset = 0;
+        uint32_t drawCommandOffset = 0;  // indirect commands submitIndirect queues
     };
 }
 